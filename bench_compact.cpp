@@ -0,0 +1,229 @@
+// Measures scans over the owned objects of a vector of arena_indirect_values
+// before and after compact() restores their locality, or while
+// views::indirect_prefetch hides their latency, and copies of a vector of
+// indirect_values with and without copy_range().
+//
+// The owned objects are laid out in one of three ways:
+//   ordered    allocated in the order of the vector, as when it was built
+//   churned    each one replaced in a random order, as after heavy churn, so
+//              consecutive elements own objects at unrelated addresses
+//   compacted  churned, then compacted into a fresh arena
+//
+// These operations are measured:
+//   scan               a pass which reads the owned object of every element
+//   scan/prefetch      the same pass over views::indirect_prefetch(8)
+//   compact            compacting a churned vector into a fresh arena
+//   copy/vector        copying a vector<indirect_value<T>>, which allocates
+//                      each copy of an owned object on its own
+//   copy/copy_range    copying it with copy_range into a fresh arena
+//
+// Element counts sweep from 1024 elements up to max_dataset_bytes of owned
+// objects, beyond the size of a last-level cache. Benchmarks are named
+// <operation>/n=<elements>/cold=<bytes>[/<layout>][/prefetch] or
+// copy/n=<elements>/cold=<bytes>/<method>, and report the time per
+// element as median_ns_per_item.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_harness.h"
+#include "indirect_value_arena.h"
+#include "indirect_value_prefetch.h"
+
+using isocpp_p1950::arena;
+using isocpp_p1950::arena_indirect_value;
+using isocpp_p1950::indirect_value;
+using isocpp_p1950::make_arena_indirect_value;
+
+namespace {
+
+constexpr std::size_t max_dataset_bytes = std::size_t(64) << 20;
+
+template <std::size_t Size>
+struct LargeData {
+  explicit LargeData(std::size_t i) {
+    std::memset(bytes, int(i & 0xff), sizeof(bytes));
+  }
+  unsigned char bytes[Size];
+};
+
+enum class layout { ordered, churned, compacted };
+
+const char* name(layout l) {
+  switch (l) {
+    case layout::ordered:
+      return "ordered";
+    case layout::churned:
+      return "churned";
+    case layout::compacted:
+      return "compacted";
+  }
+  return "";
+}
+
+// A vector and the arena of its owned objects.
+template <std::size_t ColdSize>
+struct dataset {
+  using element = arena_indirect_value<LargeData<ColdSize>>;
+
+  // Destroyed after the elements.
+  std::unique_ptr<arena> memory = std::make_unique<arena>();
+  std::vector<element> elements;
+
+  dataset(std::size_t n, layout l) {
+    elements.reserve(n);
+    for (std::size_t i = 0; i != n; ++i) {
+      elements.push_back(
+          make_arena_indirect_value<LargeData<ColdSize>>(*memory, i));
+    }
+    if (l == layout::ordered) return;
+
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(n));
+    for (std::size_t i : order) {
+      elements[i] =
+          make_arena_indirect_value<LargeData<ColdSize>>(*memory, i);
+    }
+    if (l == layout::compacted) compact();
+  }
+
+  void compact() {
+    auto fresh = std::make_unique<arena>();
+    isocpp_p1950::compact(elements, *fresh);
+    memory = std::move(fresh);
+  }
+};
+
+template <std::size_t ColdSize>
+std::vector<indirect_value<LargeData<ColdSize>>> make_free_store(
+    std::size_t n) {
+  std::vector<indirect_value<LargeData<ColdSize>>> elements;
+  elements.reserve(n);
+  for (std::size_t i = 0; i != n; ++i) elements.emplace_back(std::in_place, i);
+  return elements;
+}
+
+template <std::size_t ColdSize>
+std::uint64_t scan(const dataset<ColdSize>& data) {
+  std::uint64_t sum = 0;
+  for (const auto& e : data.elements) sum += e->bytes[0];
+  return sum;
+}
+
+template <std::size_t ColdSize>
+std::uint64_t scan_prefetched(const dataset<ColdSize>& data) {
+  std::uint64_t sum = 0;
+  for (const auto& cold :
+       data.elements | isocpp_p1950::views::indirect_prefetch(8)) {
+    sum += cold.bytes[0];
+  }
+  return sum;
+}
+
+// The data set of the running scan benchmark. Only one is kept alive at a
+// time, and benchmarks run one after another, so each data set is built
+// once, outside the measurement.
+std::shared_ptr<const void> cached;
+std::string cached_name;
+
+template <std::size_t ColdSize>
+const dataset<ColdSize>& cached_dataset(bench::state& s, std::size_t n,
+                                        layout l, const std::string& name) {
+  if (cached_name != name) {
+    s.pause();
+    cached.reset();
+    cached = std::make_shared<dataset<ColdSize>>(n, l);
+    cached_name = name;
+    s.resume();
+  }
+  return *static_cast<const dataset<ColdSize>*>(cached.get());
+}
+
+template <std::size_t ColdSize>
+void add_cold_size() {
+  for (std::size_t n = 1024; n * ColdSize <= max_dataset_bytes; n *= 8) {
+    const std::string suffix = "n=" + std::to_string(n) +
+                               "/cold=" + std::to_string(ColdSize);
+    for (layout l : {layout::ordered, layout::churned, layout::compacted}) {
+      const std::string benchmark = "scan/" + suffix + "/" + name(l);
+      bench::add(benchmark, [n, l, benchmark](bench::state& s) {
+        const auto& data = cached_dataset<ColdSize>(s, n, l, benchmark);
+        s.set_items_per_iteration(n);
+        for (std::size_t i = 0; i != s.iterations(); ++i) {
+          bench::do_not_optimize(scan(data));
+        }
+      });
+      bench::add(benchmark + "/prefetch", [n, l, benchmark](bench::state& s) {
+        const auto& data = cached_dataset<ColdSize>(s, n, l, benchmark);
+        s.set_items_per_iteration(n);
+        for (std::size_t i = 0; i != s.iterations(); ++i) {
+          bench::do_not_optimize(scan_prefetched(data));
+        }
+      });
+    }
+    bench::add("compact/" + suffix, [n](bench::state& s) {
+      s.set_items_per_iteration(n);
+      for (std::size_t i = 0; i != s.iterations(); ++i) {
+        s.pause();
+        {
+          cached.reset();
+          cached_name.clear();
+          dataset<ColdSize> data(n, layout::churned);
+          s.resume();
+          data.compact();
+          bench::clobber_memory();
+          s.pause();
+        }
+        s.resume();
+      }
+    });
+    bench::add("copy/" + suffix + "/vector", [n](bench::state& s) {
+      s.pause();
+      cached.reset();
+      cached_name.clear();
+      const auto elements = make_free_store<ColdSize>(n);
+      s.resume();
+      s.set_items_per_iteration(n);
+      for (std::size_t i = 0; i != s.iterations(); ++i) {
+        auto copy = elements;
+        bench::do_not_optimize(copy.data());
+        s.pause();
+        copy = {};
+        s.resume();
+      }
+    });
+    bench::add("copy/" + suffix + "/copy_range", [n](bench::state& s) {
+      s.pause();
+      cached.reset();
+      cached_name.clear();
+      const auto elements = make_free_store<ColdSize>(n);
+      s.resume();
+      s.set_items_per_iteration(n);
+      for (std::size_t i = 0; i != s.iterations(); ++i) {
+        auto memory = std::make_unique<arena>();
+        auto copy = isocpp_p1950::copy_range(elements, *memory);
+        bench::do_not_optimize(copy.data());
+        s.pause();
+        copy = {};
+        memory.reset();
+        s.resume();
+      }
+    });
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  add_cold_size<64>();
+  add_cold_size<256>();
+  return bench::main(argc, argv);
+}
@@ -0,0 +1,472 @@
+#ifndef ISOCPP_P1950_BENCH_HARNESS_H
+#define ISOCPP_P1950_BENCH_HARNESS_H
+
+// A minimal, header-only harness for the benchmarks of indirect_value.
+//
+// A benchmark is a function taking a bench::state, which runs the measured
+// operation state.iterations() times. The harness calibrates the number of
+// iterations so that one run takes at least the minimum time, repeats the
+// run, and writes the time per iteration of every benchmark as JSON.
+//
+// Work which is not part of the measurement, such as creating the objects a
+// benchmark destroys, is excluded by bracketing it with state.pause() and
+// state.resume().
+//
+// On Linux, the measured repetitions also count instructions, L1 data cache,
+// last-level cache and data TLB read misses, and branch misses with
+// perf_event_open, and report them per iteration. Counters which the kernel
+// or the hardware does not provide, for example because of
+// /proc/sys/kernel/perf_event_paranoid, are left out of the results.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/perf_event.h>)
+#define ISOCPP_P1950_BENCH_PERF_EVENTS 1
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace bench {
+
+// Prevents the compiler from optimising away the computation of value.
+template <class T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const void* sink;
+  sink = &value;
+#endif
+}
+
+// Prevents the compiler from optimising away or reordering writes to memory.
+inline void clobber_memory() {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : : "memory");
+#else
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// Hardware performance counters of the calling thread, opened as one group
+// so that they are enabled and disabled together.
+class counters {
+ public:
+  static constexpr std::size_t max_size = 5;
+
+#ifdef ISOCPP_P1950_BENCH_PERF_EVENTS
+  counters() {
+    constexpr auto cache_read_miss = [](std::uint64_t cache) {
+      return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    };
+    const spec specs[] = {
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"l1d_misses", PERF_TYPE_HW_CACHE,
+         cache_read_miss(PERF_COUNT_HW_CACHE_L1D)},
+        {"llc_misses", PERF_TYPE_HW_CACHE,
+         cache_read_miss(PERF_COUNT_HW_CACHE_LL)},
+        {"dtlb_misses", PERF_TYPE_HW_CACHE,
+         cache_read_miss(PERF_COUNT_HW_CACHE_DTLB)},
+        {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    };
+    for (const spec& sp : specs) {
+      perf_event_attr attr{};
+      attr.size = sizeof(attr);
+      attr.type = sp.type;
+      attr.config = sp.config;
+      attr.disabled = size_ == 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                         PERF_FORMAT_TOTAL_TIME_RUNNING;
+      const int leader = size_ == 0 ? -1 : fds_[0];
+      const int fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+      if (fd < 0) {
+        if (status_.empty()) status_ = sp.name + (": " + errno_message());
+        continue;
+      }
+      fds_[size_] = fd;
+      names_[size_] = sp.name;
+      ++size_;
+    }
+    if (size_ == 0) status_ = "unavailable (" + status_ + ")";
+  }
+
+  ~counters() {
+    for (std::size_t i = size_; i != 0; --i) close(fds_[i - 1]);
+  }
+
+  void reset() { group_ioctl(PERF_EVENT_IOC_RESET); }
+  void enable() { group_ioctl(PERF_EVENT_IOC_ENABLE); }
+  void disable() { group_ioctl(PERF_EVENT_IOC_DISABLE); }
+
+  // Reads the counts since the last reset into values, scaled up if the
+  // group was only counting for part of the time it was enabled. Returns
+  // false if nothing was counted.
+  bool read(double (&values)[max_size]) const {
+    if (size_ == 0) return false;
+    std::uint64_t data[3 + max_size];
+    const auto expected = ssize_t((3 + size_) * sizeof(std::uint64_t));
+    if (::read(fds_[0], data, sizeof(data)) != expected) return false;
+    const std::uint64_t enabled = data[1];
+    const std::uint64_t running = data[2];
+    if (running == 0) return false;
+    for (std::size_t i = 0; i != size_; ++i) {
+      values[i] = double(data[3 + i]) * double(enabled) / double(running);
+    }
+    return true;
+  }
+#else
+  void reset() {}
+  void enable() {}
+  void disable() {}
+  bool read(double (&)[max_size]) const { return false; }
+#endif
+
+  counters(const counters&) = delete;
+  counters& operator=(const counters&) = delete;
+
+  std::size_t size() const noexcept { return size_; }
+  const char* name(std::size_t i) const noexcept { return names_[i]; }
+
+  // Describes counters which could not be opened, if any.
+  const std::string& status() const noexcept { return status_; }
+
+ private:
+#ifdef ISOCPP_P1950_BENCH_PERF_EVENTS
+  struct spec {
+    const char* name;
+    std::uint32_t type;
+    std::uint64_t config;
+  };
+
+  static std::string errno_message() {
+    const int error = errno;
+    if (error == EACCES || error == EPERM) {
+      return "not permitted, see /proc/sys/kernel/perf_event_paranoid";
+    }
+    return std::strerror(error);
+  }
+
+  void group_ioctl(unsigned long request) {
+    if (size_ != 0) ioctl(fds_[0], request, PERF_IOC_FLAG_GROUP);
+  }
+
+  int fds_[max_size] = {};
+#endif
+  const char* names_[max_size] = {};
+  std::size_t size_ = 0;
+#ifdef ISOCPP_P1950_BENCH_PERF_EVENTS
+  std::string status_;
+#else
+  std::string status_ = "unavailable (not supported on this platform)";
+#endif
+};
+
+class state {
+  using clock = std::chrono::steady_clock;
+
+ public:
+  explicit state(std::size_t iterations, counters* c = nullptr)
+      : iterations_(iterations), counters_(c) {}
+
+  std::size_t iterations() const noexcept { return iterations_; }
+
+  // Sets the number of items, such as elements scanned, which one iteration
+  // processes, so that the time per item is reported as well.
+  void set_items_per_iteration(std::size_t n) noexcept {
+    items_per_iteration_ = n;
+  }
+  std::size_t items_per_iteration() const noexcept {
+    return items_per_iteration_;
+  }
+
+  // Excludes the time and counts until the matching resume() from the
+  // measurement.
+  void pause() {
+    if (counters_) counters_->disable();
+    paused_at_ = clock::now();
+  }
+
+  void resume() {
+    excluded_ += clock::now() - paused_at_;
+    if (counters_) counters_->enable();
+  }
+
+  // Runs f, timing and counting everything but the paused intervals.
+  template <class F>
+  std::chrono::nanoseconds run(F&& f) {
+    excluded_ = clock::duration::zero();
+    if (counters_) {
+      counters_->reset();
+      counters_->enable();
+    }
+    const clock::time_point start = clock::now();
+    f(*this);
+    const clock::duration elapsed = clock::now() - start - excluded_;
+    if (counters_) counters_->disable();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+  }
+
+ private:
+  std::size_t iterations_;
+  counters* counters_;
+  std::size_t items_per_iteration_ = 1;
+  clock::time_point paused_at_;
+  clock::duration excluded_{};
+};
+
+struct options {
+  double min_time = 0.1;  // Seconds per repetition.
+  int repetitions = 5;
+  std::string filter;  // Only benchmarks whose name contains this run.
+  std::string output;  // JSON is written to this file, or to stdout.
+  bool use_counters = true;
+};
+
+struct result {
+  std::string name;
+  std::size_t iterations;
+  std::size_t items_per_iteration;
+  std::vector<double> ns_per_iteration;  // One per repetition.
+  // Mean count per iteration over all repetitions of each counter.
+  std::vector<std::pair<std::string, double>> counters_per_iteration;
+};
+
+class registry {
+ public:
+  using function = std::function<void(state&)>;
+
+  static registry& instance() {
+    static registry r;
+    return r;
+  }
+
+  void add(std::string name, function f) {
+    benchmarks_.emplace_back(std::move(name), std::move(f));
+  }
+
+  std::vector<result> run(const options& o, counters* c) const {
+    std::vector<result> results;
+    for (const auto& [name, f] : benchmarks_) {
+      if (name.find(o.filter) == std::string::npos) continue;
+      std::fprintf(stderr, "%s\n", name.c_str());
+      result r{name, calibrate(f, o.min_time), 1, {}, {}};
+      double totals[counters::max_size] = {};
+      bool counted = c != nullptr;
+      for (int i = 0; i < o.repetitions; ++i) {
+        state s(r.iterations, c);
+        const auto elapsed = s.run(f);
+        r.items_per_iteration = s.items_per_iteration();
+        r.ns_per_iteration.push_back(double(elapsed.count()) /
+                                     double(r.iterations));
+        double values[counters::max_size];
+        counted = counted && c->read(values);
+        for (std::size_t j = 0; counted && j != c->size(); ++j) {
+          totals[j] += values[j];
+        }
+      }
+      for (std::size_t j = 0; counted && j != c->size(); ++j) {
+        r.counters_per_iteration.emplace_back(
+            c->name(j),
+            totals[j] / (double(o.repetitions) * double(r.iterations)));
+      }
+      results.push_back(std::move(r));
+    }
+    return results;
+  }
+
+ private:
+  // Returns a number of iterations for which f runs for at least min_time.
+  static std::size_t calibrate(const function& f, double min_time) {
+    const double target = min_time * 1e9;
+    std::size_t iterations = 1;
+    for (;;) {
+      state s(iterations);
+      const double elapsed = double(s.run(f).count());
+      if (elapsed >= target || iterations >= (std::size_t(1) << 40)) {
+        return iterations;
+      }
+      // Aim 40% past the target, but grow by at least 2 and at most 100
+      // times, so that a noisy short run cannot make the next one too long.
+      const double scale =
+          elapsed > 0 ? std::clamp(1.4 * target / elapsed, 2.0, 100.0) : 100.0;
+      iterations = std::size_t(double(iterations) * scale);
+    }
+  }
+
+  std::vector<std::pair<std::string, function>> benchmarks_;
+};
+
+inline void add(std::string name, registry::function f) {
+  registry::instance().add(std::move(name), std::move(f));
+}
+
+inline std::string json_escape(const std::string& s) {
+  std::string escaped;
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char code[8];
+      std::snprintf(code, sizeof(code), "\\u%04x",
+                    static_cast<unsigned>(static_cast<unsigned char>(c)));
+      escaped += code;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+inline void write_json(std::FILE* out, const options& o,
+                       const std::string& counter_status,
+                       const std::vector<result>& results) {
+  char date[32];
+  const std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+#if defined(__clang__)
+  const std::string compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+  const std::string compiler = "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+  const std::string compiler = "msvc " + std::to_string(_MSC_FULL_VER);
+#else
+  const std::string compiler = "unknown";
+#endif
+#ifdef NDEBUG
+  const bool assertions = false;
+#else
+  const bool assertions = true;
+#endif
+
+  std::fprintf(out, "{\n  \"context\": {\n");
+  std::fprintf(out, "    \"date\": \"%s\",\n", date);
+  std::fprintf(out, "    \"compiler\": \"%s\",\n",
+               json_escape(compiler).c_str());
+  std::fprintf(out, "    \"assertions\": %s,\n",
+               assertions ? "true" : "false");
+  std::fprintf(out, "    \"min_time\": %g,\n", o.min_time);
+  std::fprintf(out, "    \"repetitions\": %d,\n", o.repetitions);
+  std::fprintf(out, "    \"counters\": \"%s\"\n  },\n",
+               json_escape(counter_status).c_str());
+  std::fprintf(out, "  \"benchmarks\": [");
+  for (std::size_t i = 0; i != results.size(); ++i) {
+    const result& r = results[i];
+    std::vector<double> sorted = r.ns_per_iteration;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = 0;
+    for (double t : sorted) mean += t / double(sorted.size());
+    const double median =
+        sorted.empty() ? 0
+                       : (sorted[(sorted.size() - 1) / 2] +
+                          sorted[sorted.size() / 2]) /
+                             2;
+    std::fprintf(out, "%s\n    {\n", i ? "," : "");
+    std::fprintf(out, "      \"name\": \"%s\",\n",
+                 json_escape(r.name).c_str());
+    std::fprintf(out, "      \"iterations\": %zu,\n", r.iterations);
+    std::fprintf(out, "      \"items_per_iteration\": %zu,\n",
+                 r.items_per_iteration);
+    std::fprintf(out, "      \"ns_per_iteration\": {");
+    std::fprintf(out, "\"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, ",
+                 sorted.empty() ? 0 : sorted.front(), median, mean);
+    std::fprintf(out, "\"max\": %.3f},\n",
+                 sorted.empty() ? 0 : sorted.back());
+    std::fprintf(out, "      \"median_ns_per_item\": %.3f",
+                 median / double(r.items_per_iteration));
+    if (!r.counters_per_iteration.empty()) {
+      std::fprintf(out, ",\n      \"counters_per_iteration\": {");
+      for (std::size_t j = 0; j != r.counters_per_iteration.size(); ++j) {
+        std::fprintf(out, "%s\"%s\": %.3f", j ? ", " : "",
+                     r.counters_per_iteration[j].first.c_str(),
+                     r.counters_per_iteration[j].second);
+      }
+      std::fprintf(out, "}");
+    }
+    std::fprintf(out, "\n    }");
+  }
+  std::fprintf(out, "\n  ]\n}\n");
+}
+
+// Runs the registered benchmarks as configured by the command line:
+//   --filter <text>     only run benchmarks whose name contains text
+//   --min-time <s>      minimum time of one repetition, in seconds
+//   --repetitions <n>   number of measured repetitions
+//   --output <file>     write JSON to file instead of stdout
+//   --quick             one short repetition, to check that all benchmarks run
+//   --no-counters       do not use hardware performance counters
+inline int main(int argc, char** argv) {
+  options o;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--filter" && has_value) {
+      o.filter = argv[++i];
+    } else if (arg == "--min-time" && has_value) {
+      o.min_time = std::atof(argv[++i]);
+    } else if (arg == "--repetitions" && has_value) {
+      o.repetitions = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--output" && has_value) {
+      o.output = argv[++i];
+    } else if (arg == "--quick") {
+      o.min_time = 0;
+      o.repetitions = 1;
+    } else if (arg == "--no-counters") {
+      o.use_counters = false;
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--filter <text>] [--min-time <seconds>] "
+                   "[--repetitions <n>] [--output <file>] [--quick] "
+                   "[--no-counters]\n",
+                   argv[0]);
+      return 2;
+    }
+  }
+
+  std::unique_ptr<counters> c;
+  std::string counter_status = "disabled";
+  if (o.use_counters) {
+    c = std::make_unique<counters>();
+    counter_status = c->status().empty() ? "available" : c->status();
+    if (c->size() == 0) c.reset();
+    std::fprintf(stderr, "performance counters: %s\n", counter_status.c_str());
+  }
+
+  const std::vector<result> results = registry::instance().run(o, c.get());
+
+  std::FILE* out =
+      o.output.empty() ? stdout : std::fopen(o.output.c_str(), "w");
+  if (!out) {
+    std::fprintf(stderr, "cannot open %s\n", o.output.c_str());
+    return 1;
+  }
+  write_json(out, o, counter_status, results);
+  if (out != stdout) std::fclose(out);
+  return 0;
+}
+
+}  // namespace bench
+
+#endif  // ISOCPP_P1950_BENCH_HARNESS_H
@@ -0,0 +1,277 @@
+// Measures the hot-cold splitting example of documentation/p1950.md.
+//
+// Elements hold small, frequently accessed data and large, infrequently
+// accessed data, stored in one of four layouts:
+//   inline    vector<Element> with both parts inside the element
+//   indirect  vector<Element> with the large part in an indirect_value
+//   soa       one vector for each part (structure of arrays)
+//   split     split_vector<SmallData, LargeData>
+//
+// Two passes are measured over every layout:
+//   find_active  find_if over the frequently accessed data, for an element
+//                which is only active at the end, so every element is read
+//   touch_cold   a pass which reads the infrequently accessed data of every
+//                element as well
+//
+// Element counts sweep the frequently accessed data from the size of an L1
+// cache to beyond a last-level cache, and the infrequently accessed data from
+// 64 bytes to 4 KiB. Configurations whose inline layout would exceed
+// max_dataset_bytes are skipped. Benchmarks are named
+// <pass>/n=<elements>/cold=<bytes>/<layout>, and report the time per element
+// as median_ns_per_item.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_harness.h"
+#include "indirect_value.h"
+#include "split_vector.h"
+
+using isocpp_p1950::indirect_value;
+using isocpp_p1950::split_vector;
+
+namespace {
+
+constexpr std::size_t max_dataset_bytes = std::size_t(512) << 20;
+
+struct SmallData {
+  std::uint64_t key;
+  std::uint32_t flags;
+  std::uint32_t weight;
+
+  bool active() const { return flags & 1; }
+};
+
+template <std::size_t Size>
+struct LargeData {
+  unsigned char bytes[Size];
+};
+
+SmallData make_small(std::size_t i, std::size_t n) {
+  return {i, i + 1 == n ? 1u : 0u, std::uint32_t(i)};
+}
+
+template <class Large>
+void fill_large(Large& large, std::size_t i) {
+  std::memset(large.bytes, int(i & 0xff), sizeof(large.bytes));
+}
+
+template <std::size_t ColdSize>
+struct inline_layout {
+  static constexpr const char* name = "inline";
+
+  struct Element {
+    SmallData frequently_accessed_data;
+    LargeData<ColdSize> infrequently_accessed_data;
+  };
+  using container = std::vector<Element>;
+
+  static container make(std::size_t n) {
+    container elements(n);
+    for (std::size_t i = 0; i != n; ++i) {
+      elements[i].frequently_accessed_data = make_small(i, n);
+      fill_large(elements[i].infrequently_accessed_data, i);
+    }
+    return elements;
+  }
+
+  static std::size_t find_active(const container& elements) {
+    auto active = std::find_if(
+        elements.begin(), elements.end(),
+        [](const auto& e) { return e.frequently_accessed_data.active(); });
+    return std::size_t(active - elements.begin());
+  }
+
+  static std::uint64_t touch_cold(const container& elements) {
+    std::uint64_t sum = 0;
+    for (const auto& e : elements) {
+      sum += e.frequently_accessed_data.weight +
+             e.infrequently_accessed_data.bytes[0];
+    }
+    return sum;
+  }
+};
+
+template <std::size_t ColdSize>
+struct indirect_layout {
+  static constexpr const char* name = "indirect";
+
+  struct Element {
+    SmallData frequently_accessed_data;
+    indirect_value<LargeData<ColdSize>> infrequently_accessed_data;
+  };
+  using container = std::vector<Element>;
+
+  static container make(std::size_t n) {
+    container elements(n);
+    for (std::size_t i = 0; i != n; ++i) {
+      elements[i].frequently_accessed_data = make_small(i, n);
+      elements[i].infrequently_accessed_data.emplace();
+      fill_large(*elements[i].infrequently_accessed_data, i);
+    }
+    return elements;
+  }
+
+  static std::size_t find_active(const container& elements) {
+    auto active = std::find_if(
+        elements.begin(), elements.end(),
+        [](const auto& e) { return e.frequently_accessed_data.active(); });
+    return std::size_t(active - elements.begin());
+  }
+
+  static std::uint64_t touch_cold(const container& elements) {
+    std::uint64_t sum = 0;
+    for (const auto& e : elements) {
+      sum += e.frequently_accessed_data.weight +
+             e.infrequently_accessed_data->bytes[0];
+    }
+    return sum;
+  }
+};
+
+template <std::size_t ColdSize>
+struct soa_layout {
+  static constexpr const char* name = "soa";
+
+  struct container {
+    std::vector<SmallData> frequently_accessed_data;
+    std::vector<LargeData<ColdSize>> infrequently_accessed_data;
+  };
+
+  static container make(std::size_t n) {
+    container elements;
+    elements.frequently_accessed_data.resize(n);
+    elements.infrequently_accessed_data.resize(n);
+    for (std::size_t i = 0; i != n; ++i) {
+      elements.frequently_accessed_data[i] = make_small(i, n);
+      fill_large(elements.infrequently_accessed_data[i], i);
+    }
+    return elements;
+  }
+
+  static std::size_t find_active(const container& elements) {
+    const auto& hot = elements.frequently_accessed_data;
+    auto active = std::find_if(hot.begin(), hot.end(),
+                               [](const auto& h) { return h.active(); });
+    return std::size_t(active - hot.begin());
+  }
+
+  static std::uint64_t touch_cold(const container& elements) {
+    std::uint64_t sum = 0;
+    const std::size_t n = elements.frequently_accessed_data.size();
+    for (std::size_t i = 0; i != n; ++i) {
+      sum += elements.frequently_accessed_data[i].weight +
+             elements.infrequently_accessed_data[i].bytes[0];
+    }
+    return sum;
+  }
+};
+
+template <std::size_t ColdSize>
+struct split_layout {
+  static constexpr const char* name = "split";
+
+  using container = split_vector<SmallData, LargeData<ColdSize>>;
+
+  static container make(std::size_t n) {
+    container elements(n);
+    for (std::size_t i = 0; i != n; ++i) {
+      elements[i].hot() = make_small(i, n);
+      fill_large(*elements[i].cold(), i);
+    }
+    return elements;
+  }
+
+  static std::size_t find_active(const container& elements) {
+    auto active =
+        std::find_if(elements.begin(), elements.end(),
+                     [](const auto& e) { return e.hot().active(); });
+    return std::size_t(active - elements.begin());
+  }
+
+  static std::uint64_t touch_cold(const container& elements) {
+    std::uint64_t sum = 0;
+    for (const auto e : elements) {
+      sum += e.hot().weight + e.cold()->bytes[0];
+    }
+    return sum;
+  }
+};
+
+// The data set of the running benchmark. Only one is kept alive at a time,
+// and benchmarks run one after another, so each data set is built once,
+// outside the measurement.
+struct dataset_cache {
+  std::shared_ptr<const void> data;
+  const void* layout = nullptr;
+  std::size_t n = 0;
+};
+
+dataset_cache cache;
+
+template <class Layout>
+const typename Layout::container& dataset(bench::state& s, std::size_t n) {
+  static const char tag = 0;
+  if (cache.layout != &tag || cache.n != n) {
+    s.pause();
+    cache.data.reset();
+    cache.data =
+        std::make_shared<typename Layout::container>(Layout::make(n));
+    cache.layout = &tag;
+    cache.n = n;
+    s.resume();
+  }
+  return *static_cast<const typename Layout::container*>(cache.data.get());
+}
+
+template <class Layout>
+void add_layout(std::size_t n, const std::string& suffix) {
+  bench::add("find_active/" + suffix + Layout::name,
+             [n](bench::state& s) {
+               const auto& elements = dataset<Layout>(s, n);
+               s.set_items_per_iteration(n);
+               for (std::size_t i = 0; i != s.iterations(); ++i) {
+                 bench::do_not_optimize(Layout::find_active(elements));
+               }
+             });
+  bench::add("touch_cold/" + suffix + Layout::name,
+             [n](bench::state& s) {
+               const auto& elements = dataset<Layout>(s, n);
+               s.set_items_per_iteration(n);
+               for (std::size_t i = 0; i != s.iterations(); ++i) {
+                 bench::do_not_optimize(Layout::touch_cold(elements));
+               }
+             });
+}
+
+template <std::size_t ColdSize>
+void add_cold_size() {
+  // 16 KiB to 64 MiB of frequently accessed data.
+  for (std::size_t n = 1024; n <= (std::size_t(1) << 22); n *= 8) {
+    if (n * sizeof(typename inline_layout<ColdSize>::Element) >
+        max_dataset_bytes) {
+      break;
+    }
+    const std::string suffix = "n=" + std::to_string(n) +
+                               "/cold=" + std::to_string(ColdSize) + "/";
+    add_layout<inline_layout<ColdSize>>(n, suffix);
+    add_layout<indirect_layout<ColdSize>>(n, suffix);
+    add_layout<soa_layout<ColdSize>>(n, suffix);
+    add_layout<split_layout<ColdSize>>(n, suffix);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  add_cold_size<64>();
+  add_cold_size<256>();
+  add_cold_size<1024>();
+  add_cold_size<4096>();
+  return bench::main(argc, argv);
+}
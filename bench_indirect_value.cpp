@@ -0,0 +1,289 @@
+// Micro-benchmarks of the operations of indirect_value, each compared with
+// std::unique_ptr, std::optional and a plain value of the same type.
+//
+// Benchmarks are named <operation>/<subject><<type>>, for example
+// copy/indirect_value<std::string>. Run with --help for the options.
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "bench_harness.h"
+#include "indirect_value.h"
+
+#if defined(__cpp_lib_three_way_comparison) && defined(__cpp_lib_concepts)
+#define ISOCPP_P1950_BENCH_THREE_WAY 1
+#else
+#define ISOCPP_P1950_BENCH_THREE_WAY 0
+#endif
+
+using isocpp_p1950::indirect_value;
+
+namespace {
+
+// Each subject wraps a T and provides the operations the benchmarks measure,
+// written as a user of that wrapper with value semantics would write them.
+template <class T>
+struct indirect_value_subject {
+  static constexpr const char* name = "indirect_value";
+  using type = indirect_value<T>;
+  static type make(const T& v) { return type(std::in_place, v); }
+  static type copy(const type& t) { return t; }
+  static void copy_assign(type& t, const type& u) { t = u; }
+  static bool equal(const type& t, const type& u) { return t == u; }
+  static std::size_t hash(const type& t) { return std::hash<type>{}(t); }
+#if ISOCPP_P1950_BENCH_THREE_WAY
+  static auto compare(const type& t, const type& u) { return t <=> u; }
+#endif
+};
+
+// A class holding a unique_ptr copies its owned object by hand.
+template <class T>
+struct unique_ptr_subject {
+  static constexpr const char* name = "unique_ptr";
+  using type = std::unique_ptr<T>;
+  static type make(const T& v) { return std::make_unique<T>(v); }
+  static type copy(const type& t) {
+    return t ? std::make_unique<T>(*t) : nullptr;
+  }
+  static void copy_assign(type& t, const type& u) { t = copy(u); }
+  static bool equal(const type& t, const type& u) {
+    return bool(t) == bool(u) && (!t || *t == *u);
+  }
+  static std::size_t hash(const type& t) {
+    return t ? std::hash<T>{}(*t) : 0;
+  }
+#if ISOCPP_P1950_BENCH_THREE_WAY
+  static auto compare(const type& t, const type& u) {
+    return t && u ? *t <=> *u : bool(t) <=> bool(u);
+  }
+#endif
+};
+
+template <class T>
+struct optional_subject {
+  static constexpr const char* name = "optional";
+  using type = std::optional<T>;
+  static type make(const T& v) { return type(std::in_place, v); }
+  static type copy(const type& t) { return t; }
+  static void copy_assign(type& t, const type& u) { t = u; }
+  static bool equal(const type& t, const type& u) { return t == u; }
+  static std::size_t hash(const type& t) { return std::hash<type>{}(t); }
+#if ISOCPP_P1950_BENCH_THREE_WAY
+  static auto compare(const type& t, const type& u) { return t <=> u; }
+#endif
+};
+
+template <class T>
+struct value_subject {
+  static constexpr const char* name = "value";
+  using type = T;
+  static type make(const T& v) { return v; }
+  static type copy(const type& t) { return t; }
+  static void copy_assign(type& t, const type& u) { t = u; }
+  static bool equal(const type& t, const type& u) { return t == u; }
+  static std::size_t hash(const type& t) { return std::hash<type>{}(t); }
+#if ISOCPP_P1950_BENCH_THREE_WAY
+  static auto compare(const type& t, const type& u) { return t <=> u; }
+#endif
+};
+
+template <class T>
+struct sample;
+
+template <>
+struct sample<int> {
+  static constexpr const char* name = "int";
+  static int first() { return 42; }
+  static int second() { return 43; }
+};
+
+// Long enough to be allocated outside the string object.
+template <>
+struct sample<std::string> {
+  static constexpr const char* name = "std::string";
+  static std::string first() { return std::string(48, 'a'); }
+  static std::string second() { return std::string(48, 'b'); }
+};
+
+// Objects are created and destroyed in batches, so that construction and
+// destruction can be measured separately.
+constexpr std::size_t batch_size = 1024;
+
+template <class Type>
+class batch {
+ public:
+  batch() : storage_(new storage[batch_size]) {}
+  Type* data() { return reinterpret_cast<Type*>(storage_.get()); }
+  void destroy(std::size_t n) { std::destroy_n(data(), n); }
+
+ private:
+  struct storage {
+    alignas(Type) unsigned char bytes[sizeof(Type)];
+  };
+  std::unique_ptr<storage[]> storage_;
+};
+
+// Times constructing s.iterations() objects, excluding their destruction.
+// Before each batch of n objects, prepare(n) runs untimed; make(i) returns
+// the i-th object of the batch.
+template <class Type, class Prepare, class Make>
+void time_construction(bench::state& s, Prepare prepare, Make make) {
+  s.pause();
+  batch<Type> objects;
+  s.resume();
+  for (std::size_t done = 0; done < s.iterations();) {
+    const std::size_t n = std::min(batch_size, s.iterations() - done);
+    s.pause();
+    prepare(n);
+    s.resume();
+    for (std::size_t i = 0; i != n; ++i) {
+      ::new (static_cast<void*>(objects.data() + i)) Type(make(i));
+    }
+    bench::clobber_memory();
+    s.pause();
+    objects.destroy(n);
+    s.resume();
+    done += n;
+  }
+}
+
+template <class Type, class Make>
+void time_construction(bench::state& s, Make make) {
+  time_construction<Type>(
+      s, [](std::size_t) {}, [&](std::size_t) { return make(); });
+}
+
+// Times destroying s.iterations() objects created with make.
+template <class Type, class Make>
+void time_destruction(bench::state& s, Make make) {
+  s.pause();
+  batch<Type> objects;
+  s.resume();
+  for (std::size_t done = 0; done < s.iterations();) {
+    const std::size_t n = std::min(batch_size, s.iterations() - done);
+    s.pause();
+    for (std::size_t i = 0; i != n; ++i) {
+      ::new (static_cast<void*>(objects.data() + i)) Type(make());
+    }
+    bench::clobber_memory();
+    s.resume();
+    objects.destroy(n);
+    bench::clobber_memory();
+    done += n;
+  }
+}
+
+template <class S, class T>
+void add_benchmarks() {
+  using type = typename S::type;
+  const std::string suffix =
+      std::string("/") + S::name + "<" + sample<T>::name + ">";
+
+  bench::add("construct" + suffix, [](bench::state& s) {
+    time_construction<type>(s, [] { return type(); });
+  });
+
+  bench::add("construct_in_place" + suffix, [](bench::state& s) {
+    const T value = sample<T>::first();
+    time_construction<type>(s, [&] { return S::make(value); });
+  });
+
+  bench::add("copy" + suffix, [](bench::state& s) {
+    const type source = S::make(sample<T>::first());
+    time_construction<type>(s, [&] { return S::copy(source); });
+  });
+
+  bench::add("copy_assign" + suffix, [](bench::state& s) {
+    type target = S::make(sample<T>::first());
+    const type sources[] = {S::make(sample<T>::first()),
+                            S::make(sample<T>::second())};
+    for (std::size_t i = 0; i != s.iterations(); ++i) {
+      S::copy_assign(target, sources[i & 1]);
+      bench::do_not_optimize(target);
+    }
+  });
+
+  bench::add("move" + suffix, [](bench::state& s) {
+    s.pause();
+    batch<type> sources;
+    std::size_t created = 0;
+    s.resume();
+    time_construction<type>(
+        s,
+        [&](std::size_t n) {
+          sources.destroy(created);
+          for (created = 0; created != n; ++created) {
+            ::new (static_cast<void*>(sources.data() + created))
+                type(S::make(sample<T>::first()));
+          }
+        },
+        [&](std::size_t i) { return std::move(sources.data()[i]); });
+    s.pause();
+    sources.destroy(created);
+    s.resume();
+  });
+
+  bench::add("swap" + suffix, [](bench::state& s) {
+    type a = S::make(sample<T>::first());
+    type b = S::make(sample<T>::second());
+    for (std::size_t i = 0; i != s.iterations(); ++i) {
+      using std::swap;
+      swap(a, b);
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(b);
+    }
+  });
+
+  bench::add("equal" + suffix, [](bench::state& s) {
+    const type a = S::make(sample<T>::first());
+    const type b = S::make(sample<T>::first());
+    for (std::size_t i = 0; i != s.iterations(); ++i) {
+      bench::do_not_optimize(S::equal(a, b));
+    }
+  });
+
+#if ISOCPP_P1950_BENCH_THREE_WAY
+  bench::add("compare_three_way" + suffix, [](bench::state& s) {
+    const type a = S::make(sample<T>::first());
+    const type b = S::make(sample<T>::second());
+    for (std::size_t i = 0; i != s.iterations(); ++i) {
+      bench::do_not_optimize(S::compare(a, b) < 0);
+    }
+  });
+#endif
+
+  bench::add("hash" + suffix, [](bench::state& s) {
+    const type a = S::make(sample<T>::first());
+    for (std::size_t i = 0; i != s.iterations(); ++i) {
+      bench::do_not_optimize(S::hash(a));
+    }
+  });
+
+  bench::add("destroy" + suffix, [](bench::state& s) {
+    const T value = sample<T>::first();
+    time_destruction<type>(s, [&] { return S::make(value); });
+  });
+}
+
+template <class T>
+void add_all_subjects() {
+  add_benchmarks<indirect_value_subject<T>, T>();
+  add_benchmarks<unique_ptr_subject<T>, T>();
+  add_benchmarks<optional_subject<T>, T>();
+  add_benchmarks<value_subject<T>, T>();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  add_all_subjects<int>();
+  add_all_subjects<std::string>();
+  return bench::main(argc, argv);
+}
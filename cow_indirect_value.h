@@ -0,0 +1,214 @@
+#ifndef ISOCPP_P1950_COW_INDIRECT_VALUE_H
+#define ISOCPP_P1950_COW_INDIRECT_VALUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "indirect_value.h"
+
+namespace isocpp_p1950 {
+
+// Reference count policy for cow_indirect_value objects which share an owned
+// object across threads.
+struct atomic_ref_count {
+  std::atomic<std::size_t> count{1};
+
+  void increment() noexcept { count.fetch_add(1, std::memory_order_relaxed); }
+  // Returns true when the last reference was released.
+  bool decrement() noexcept {
+    return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+  bool unique() const noexcept {
+    return count.load(std::memory_order_acquire) == 1;
+  }
+  std::size_t get() const noexcept {
+    return count.load(std::memory_order_relaxed);
+  }
+};
+
+// Reference count policy for cow_indirect_value objects which, together with
+// all their copies, are only used by one thread.
+struct non_atomic_ref_count {
+  std::size_t count = 1;
+
+  void increment() noexcept { ++count; }
+  bool decrement() noexcept { return --count == 0; }
+  bool unique() const noexcept { return count == 1; }
+  std::size_t get() const noexcept { return count; }
+};
+
+template <class T, class RefCount>
+struct _cow_node {
+  template <class... Ts>
+  explicit _cow_node(Ts&&... ts) : value(std::forward<Ts>(ts)...) {}
+
+  RefCount ref_count;
+  // Set once a non-const reference to value may have escaped; such a node is
+  // never shared again, as writes through that reference would be seen by
+  // the copies.
+  bool unshareable = false;
+  T value;
+};
+
+// A copy-on-write indirect_value.
+//
+// Copying a cow_indirect_value shares the owned object instead of copying
+// it. The owned object is copied on the first non-const access to a shared
+// cow_indirect_value, so cow_indirect_value has the same value semantics and
+// the same const propagation as indirect_value: const access never copies,
+// and changes made through non-const access are never seen by copies.
+//
+// Non-const access makes the owned object unshareable: references obtained
+// from that access may still be used to modify it, so every later copy of
+// the cow_indirect_value is a deep copy, for as long as it owns that object.
+// A value which is modified and then copied repeatedly therefore pays for a
+// copy each time, as indirect_value does, although the copies themselves
+// share their owned objects again. Once no such references are in use,
+// assigning a copy to it, as in
+//
+//   value = cow_indirect_value(value);
+//
+// replaces the owned object with a shareable one, at the cost of one copy.
+//
+// RefCount is atomic_ref_count, so that copies can be used from different
+// threads, or non_atomic_ref_count, when all copies stay on one thread.
+template <class T, class RefCount = atomic_ref_count>
+class cow_indirect_value {
+  using node = _cow_node<T, RefCount>;
+
+  node* node_ = nullptr;
+
+ public:
+  using value_type = T;
+
+  cow_indirect_value() = default;
+
+  template <class... Ts>
+  explicit cow_indirect_value(std::in_place_t, Ts&&... ts)
+      : node_(new node(std::forward<Ts>(ts)...)) {}
+
+  cow_indirect_value(const cow_indirect_value& i) : node_(i.share()) {}
+
+  cow_indirect_value(cow_indirect_value&& i) noexcept
+      : node_(std::exchange(i.node_, nullptr)) {}
+
+  cow_indirect_value& operator=(const cow_indirect_value& i) {
+    cow_indirect_value(i).swap(*this);
+    return *this;
+  }
+
+  cow_indirect_value& operator=(cow_indirect_value&& i) noexcept {
+    if (this != &i) {
+      release();
+      node_ = std::exchange(i.node_, nullptr);
+    }
+    return *this;
+  }
+
+  ~cow_indirect_value() { release(); }
+
+  T* operator->() { return node_ ? &mutable_value() : nullptr; }
+
+  const T* operator->() const noexcept {
+    return node_ ? &node_->value : nullptr;
+  }
+
+  T& operator*() & { return mutable_value(); }
+
+  const T& operator*() const& noexcept { return node_->value; }
+
+  T&& operator*() && { return std::move(mutable_value()); }
+
+  const T&& operator*() const&& noexcept { return std::move(node_->value); }
+
+  T& value() & {
+    if (!node_) throw bad_indirect_value_access();
+    return mutable_value();
+  }
+
+  const T& value() const& {
+    if (!node_) throw bad_indirect_value_access();
+    return node_->value;
+  }
+
+  T&& value() && {
+    if (!node_) throw bad_indirect_value_access();
+    return std::move(mutable_value());
+  }
+
+  const T&& value() const&& {
+    if (!node_) throw bad_indirect_value_access();
+    return std::move(node_->value);
+  }
+
+  explicit constexpr operator bool() const noexcept {
+    return node_ != nullptr;
+  }
+
+  bool has_value() const noexcept { return node_ != nullptr; }
+
+  // The number of cow_indirect_value objects sharing the owned object, or 0
+  // if there is none.
+  std::size_t use_count() const noexcept {
+    return node_ ? node_->ref_count.get() : 0;
+  }
+
+  void swap(cow_indirect_value& rhs) noexcept {
+    std::swap(node_, rhs.node_);
+  }
+
+  friend void swap(cow_indirect_value& lhs, cow_indirect_value& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+
+ private:
+  node* share() const {
+    if (!node_) return nullptr;
+    if (node_->unshareable) return new node(node_->value);
+    node_->ref_count.increment();
+    return node_;
+  }
+
+  // Makes the owned object unique to *this before giving out a non-const
+  // reference to it.
+  T& mutable_value() {
+    if (!node_->ref_count.unique()) {
+      node* copy = new node(std::as_const(node_->value));
+      release();
+      node_ = copy;
+    }
+    node_->unshareable = true;
+    return node_->value;
+  }
+
+  void release() noexcept {
+    if (node_) {
+      // As for indirect_value, set node_ to nullptr before destroying the
+      // owned object, in case its destructor accesses this object.
+      node* n = std::exchange(node_, nullptr);
+      if (n->ref_count.decrement()) delete n;
+    }
+  }
+};
+
+// cow_indirect_values compare as indirect_values do, including with them.
+// Objects which share an owned object still compare it, so that a T whose
+// comparison is not reflexive, such as a floating-point NaN, compares the
+// same whether or not its copies are shared.
+template <class T, class R>
+inline constexpr bool _is_indirect_v<cow_indirect_value<T, R>> = true;
+
+}  // namespace isocpp_p1950
+
+namespace std {
+template <class T, class R>
+struct hash<::isocpp_p1950::cow_indirect_value<T, R>>
+    : ::isocpp_p1950::_conditionally_enabled_hash<
+          ::isocpp_p1950::cow_indirect_value<T, R>,
+          is_default_constructible_v<hash<T>>> {};
+}  // namespace std
+
+#endif  // ISOCPP_P1950_COW_INDIRECT_VALUE_H
@@ -0,0 +1,203 @@
+#ifndef ISOCPP_P1950_INDIRECT_TUPLE_H
+#define ISOCPP_P1950_INDIRECT_TUPLE_H
+
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "indirect_value.h"
+
+namespace isocpp_p1950 {
+
+// Several objects in one allocation, with the value semantics of
+// indirect_value.
+//
+// A class which moves several rarely used members out of line with one
+// indirect_value each pays a pointer and an allocation per member. An
+// indirect_tuple<Ts...> holds them all in one std::tuple<Ts...> on the free
+// store, behind one pointer. Copying deep copies all of them in one
+// allocation, and constness propagates to each of them.
+//
+// Like indirect_value, a default constructed or moved-from indirect_tuple is
+// empty, and accessing the members of an empty indirect_tuple is undefined.
+// The members are reached with get<I> or get<T>, as for std::tuple, or with
+// a structured binding.
+//
+// indirect_tuples compare and hash as indirect_values of their tuple_type
+// do.
+template <class... Ts>
+class indirect_tuple {
+ public:
+  using tuple_type = std::tuple<Ts...>;
+  using value_type = tuple_type;
+
+  indirect_tuple() = default;
+
+  // Constructs the members from us, or value-initializes them without us.
+  template <class... Us, class = std::enable_if_t<
+                             std::is_constructible_v<tuple_type, Us...>>>
+  explicit indirect_tuple(std::in_place_t, Us&&... us)
+      : value_(std::in_place, std::forward<Us>(us)...) {}
+
+  template <class... Us>
+  tuple_type& emplace(Us&&... us) {
+    return value_.emplace(std::forward<Us>(us)...);
+  }
+
+  void reset() noexcept { value_.reset(); }
+
+  explicit operator bool() const noexcept { return value_.has_value(); }
+  bool has_value() const noexcept { return value_.has_value(); }
+
+  tuple_type& operator*() & { return *value_; }
+  const tuple_type& operator*() const& { return *value_; }
+  tuple_type&& operator*() && { return *std::move(value_); }
+  const tuple_type&& operator*() const&& { return *std::move(value_); }
+
+  // Throws bad_indirect_value_access when empty.
+  tuple_type& value() & { return value_.value(); }
+  const tuple_type& value() const& { return value_.value(); }
+  tuple_type&& value() && { return std::move(value_).value(); }
+  const tuple_type&& value() const&& { return std::move(value_).value(); }
+
+  template <std::size_t I>
+  std::tuple_element_t<I, tuple_type>& get() & {
+    return std::get<I>(*value_);
+  }
+  template <std::size_t I>
+  const std::tuple_element_t<I, tuple_type>& get() const& {
+    return std::get<I>(*value_);
+  }
+  template <std::size_t I>
+  std::tuple_element_t<I, tuple_type>&& get() && {
+    return std::get<I>(std::move(*value_));
+  }
+  template <std::size_t I>
+  const std::tuple_element_t<I, tuple_type>&& get() const&& {
+    return std::get<I>(std::move(*value_));
+  }
+
+  template <class T>
+  T& get() & {
+    return std::get<T>(*value_);
+  }
+  template <class T>
+  const T& get() const& {
+    return std::get<T>(*value_);
+  }
+  template <class T>
+  T&& get() && {
+    return std::get<T>(std::move(*value_));
+  }
+  template <class T>
+  const T&& get() const&& {
+    return std::get<T>(std::move(*value_));
+  }
+
+  void swap(indirect_tuple& other) noexcept { value_.swap(other.value_); }
+
+  friend void swap(indirect_tuple& lhs, indirect_tuple& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+
+ private:
+  indirect_value<tuple_type> value_;
+};
+
+template <class... Ts>
+inline constexpr bool _is_indirect_v<indirect_tuple<Ts...>> = true;
+
+// std::tuple has no hash, so the hash of an indirect_tuple combines the
+// hashes of its members, as boost::hash_combine does.
+template <class... Ts>
+struct _tuple_hash {
+  std::size_t operator()(const std::tuple<Ts...>& t) const
+      noexcept((noexcept(std::hash<Ts>{}(std::declval<const Ts&>())) &&
+                ...)) {
+    return std::apply(
+        [](const Ts&... ts) {
+          std::size_t seed = 0;
+          ((seed ^= std::hash<Ts>{}(ts) + 0x9e3779b9 + (seed << 6) +
+                    (seed >> 2)),
+           ...);
+          return seed;
+        },
+        t);
+  }
+};
+
+template <std::size_t I, class... Ts>
+std::tuple_element_t<I, std::tuple<Ts...>>& get(indirect_tuple<Ts...>& t) {
+  return t.template get<I>();
+}
+
+template <std::size_t I, class... Ts>
+const std::tuple_element_t<I, std::tuple<Ts...>>& get(
+    const indirect_tuple<Ts...>& t) {
+  return t.template get<I>();
+}
+
+template <std::size_t I, class... Ts>
+std::tuple_element_t<I, std::tuple<Ts...>>&& get(indirect_tuple<Ts...>&& t) {
+  return std::move(t).template get<I>();
+}
+
+template <std::size_t I, class... Ts>
+const std::tuple_element_t<I, std::tuple<Ts...>>&& get(
+    const indirect_tuple<Ts...>&& t) {
+  return std::move(t).template get<I>();
+}
+
+template <class T, class... Ts>
+T& get(indirect_tuple<Ts...>& t) {
+  return t.template get<T>();
+}
+
+template <class T, class... Ts>
+const T& get(const indirect_tuple<Ts...>& t) {
+  return t.template get<T>();
+}
+
+template <class T, class... Ts>
+T&& get(indirect_tuple<Ts...>&& t) {
+  return std::move(t).template get<T>();
+}
+
+template <class T, class... Ts>
+const T&& get(const indirect_tuple<Ts...>&& t) {
+  return std::move(t).template get<T>();
+}
+
+// Creates an indirect_tuple holding members constructed from us, with their
+// types decayed, as std::make_tuple does without unwrapping references.
+template <class... Us>
+indirect_tuple<std::decay_t<Us>...> make_indirect_tuple(Us&&... us) {
+  return indirect_tuple<std::decay_t<Us>...>(std::in_place,
+                                             std::forward<Us>(us)...);
+}
+
+}  // namespace isocpp_p1950
+
+namespace std {
+
+// indirect_tuple supports structured bindings.
+template <class... Ts>
+struct tuple_size<::isocpp_p1950::indirect_tuple<Ts...>>
+    : integral_constant<size_t, sizeof...(Ts)> {};
+
+template <size_t I, class... Ts>
+struct tuple_element<I, ::isocpp_p1950::indirect_tuple<Ts...>>
+    : tuple_element<I, tuple<Ts...>> {};
+
+template <class... Ts>
+struct hash<::isocpp_p1950::indirect_tuple<Ts...>>
+    : ::isocpp_p1950::_conditionally_enabled_hash<
+          ::isocpp_p1950::indirect_tuple<Ts...>,
+          (is_default_constructible_v<hash<Ts>> && ...),
+          ::isocpp_p1950::_tuple_hash<Ts...>> {};
+
+}  // namespace std
+
+#endif  // ISOCPP_P1950_INDIRECT_TUPLE_H
@@ -1,8 +1,11 @@
 #ifndef ISOCPP_P1950_INDIRECT_VALUE_H
 #define ISOCPP_P1950_INDIRECT_VALUE_H
 
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <memory>
+#include <new>
 #include <type_traits>
 #include <utility>
 
@@ -10,6 +13,12 @@
 #include <compare>
 #endif
 
+#if defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+#endif
+
 // MSVC does not apply EBCO for more than one base class, by default. To enable
 // it, you have to write `__declspec(empty_bases)` to the declaration of the
 // derived class. As indirect_value inherits from two EBCO - classes, one for
@@ -28,6 +37,132 @@ struct default_copy {
   T* operator()(const T& t) const { return new T(t); }
 };
 
+// When both sides are engaged, copy assignment of an indirect_value with the
+// default copier and deleter, and a T which is not polymorphic or is final,
+// copy-assigns the owned object in place instead of allocating a copy and
+// freeing the old object. By default this is only done when T's copy
+// assignment is noexcept, so that copy assignment keeps the strong exception
+// guarantee.
+//
+// Specialise enable_copy_assign_in_place as std::true_type to reuse the
+// owned object even when T's copy assignment may throw. Copy assignment then
+// only gives the basic exception guarantee, as for std::optional<T>: if T's
+// copy assignment throws, *this still owns an object in whatever state that
+// assignment left it.
+template <class T>
+struct enable_copy_assign_in_place : std::false_type {};
+
+// Instrumentation of indirect_value.
+//
+// indirect_value reports the lifetime events of its owned objects to an
+// instrumentation policy: a class with the static member function templates
+// below, each called with a pointer to the owned object concerned. The
+// policy is selected by defining ISOCPP_P1950_INSTRUMENTATION as its name
+// before including this header, consistently in every translation unit of a
+// program. The policy must be declared before this header is included, or be
+// isocpp_p1950::counting_instrumentation from
+// indirect_value_instrumentation.h, which is then included automatically.
+//
+// The pointer identifies the object; the object may not yet be constructed
+// when a copier such as batched_copy defers its construction, so policies
+// should not access it. By default no_instrumentation is used, whose empty
+// functions compile away.
+struct no_instrumentation {
+  // An owned object was created, other than as a copy.
+  template <class T>
+  static void created(const T*) noexcept {}
+  // An owned object was created as a copy of another.
+  template <class T>
+  static void copied(const T*) noexcept {}
+  // An owned object was copy assigned in place from another.
+  template <class T>
+  static void copy_assigned(const T*) noexcept {}
+  // Ownership of an owned object moved to another indirect_value.
+  template <class T>
+  static void moved(const T*) noexcept {}
+  // An owned object is about to be destroyed, or released from ownership.
+  template <class T>
+  static void destroyed(const T*) noexcept {}
+};
+
+}  // namespace isocpp_p1950
+
+#ifdef ISOCPP_P1950_INSTRUMENTATION
+#include "indirect_value_instrumentation.h"
+#endif
+
+namespace isocpp_p1950 {
+
+#ifdef ISOCPP_P1950_INSTRUMENTATION
+using _instrumentation = ISOCPP_P1950_INSTRUMENTATION;
+#else
+using _instrumentation = no_instrumentation;
+#endif
+
+// Static tracepoints of indirect_value.
+//
+// With ISOCPP_P1950_USDT defined, indirect_value places USDT probes, as
+// defined by <sys/sdt.h>, of the provider isocpp_p1950, which perf, bpftrace
+// and SystemTap can attach to in a running process:
+//   allocate  an owned object was created by the in_place or allocator_arg
+//             constructor, emplace, value assignment or
+//             make_indirect_value_for_overwrite
+//   copy      an owned object was copied
+//   destroy   an owned object is about to be passed to the deleter by reset
+// Each probe takes three arguments: type_name_hash of the owned type, its
+// size, and the address of the owned object. A probe is a nop until a tracer
+// attaches to it.
+#ifdef ISOCPP_P1950_USDT
+
+}  // namespace isocpp_p1950
+
+#include <sys/sdt.h>
+
+#include <cstdint>
+#include <string_view>
+
+namespace isocpp_p1950 {
+
+template <class T>
+constexpr std::string_view _type_name() noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+  constexpr std::string_view signature = __FUNCSIG__;
+  constexpr std::string_view prefix = "_type_name<";
+  constexpr std::size_t first = signature.find(prefix) + prefix.size();
+  constexpr std::size_t last = signature.rfind(">(void)");
+#else
+  // "... [with T = name; ...]" (GCC) or "... [T = name]" (Clang).
+  constexpr std::string_view signature = __PRETTY_FUNCTION__;
+  constexpr std::string_view prefix = "T = ";
+  constexpr std::size_t first = signature.find(prefix) + prefix.size();
+  constexpr std::size_t semicolon = signature.find(';', first);
+  constexpr std::size_t last =
+      semicolon != signature.npos ? semicolon : signature.rfind(']');
+#endif
+  return signature.substr(first, last - first);
+}
+
+constexpr std::uint64_t _fnv1a(std::string_view s) noexcept {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (char c : s) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// The 64-bit FNV-1a hash of the name of T, as spelt by the compiler, which
+// identifies the owned type in the arguments of the probes. A program can
+// log the names of the types it is interested in with their hashes.
+template <class T>
+inline constexpr std::uint64_t type_name_hash = _fnv1a(_type_name<T>());
+
+#define ISOCPP_P1950_PROBE(name, T, p)                                  \
+  DTRACE_PROBE3(isocpp_p1950, name, ::isocpp_p1950::type_name_hash<T>, \
+                sizeof(T), static_cast<const void*>(p))
+#else
+#define ISOCPP_P1950_PROBE(name, T, p)
+#endif
+
 class bad_indirect_value_access : public std::exception {
  public:
   const char* what() const noexcept override {
@@ -79,10 +214,350 @@ class indirect_value_delete_base<D, true> : private D {
   const D& get() const noexcept { return *this; }
 };
 
+// Allocate and construct a single T with an allocator, which is rebound to T.
+template <class T, class A, class... Ts>
+T* _allocate_with(const A& a, Ts&&... ts) {
+  using traits = typename std::allocator_traits<A>::template rebind_traits<T>;
+  typename traits::allocator_type alloc(a);
+  auto mem = traits::allocate(alloc, 1);
+  T* t = std::addressof(*mem);
+  try {
+    traits::construct(alloc, t, std::forward<Ts>(ts)...);
+  } catch (...) {
+    traits::deallocate(alloc, mem, 1);
+    throw;
+  }
+  return t;
+}
+
+// As _allocate_with, but default-initialize the T, which the allocator cannot
+// do, as for std::allocate_shared_for_overwrite.
+template <class T, class A>
+T* _allocate_for_overwrite_with(const A& a) {
+  using traits = typename std::allocator_traits<A>::template rebind_traits<T>;
+  typename traits::allocator_type alloc(a);
+  auto mem = traits::allocate(alloc, 1);
+  T* t = std::addressof(*mem);
+  try {
+    ::new (static_cast<void*>(t)) T;
+  } catch (...) {
+    traits::deallocate(alloc, mem, 1);
+    throw;
+  }
+  return t;
+}
+
+// Destroy and deallocate a T obtained from _allocate_with.
+template <class T, class A>
+void _deallocate_with(const A& a, T* t) noexcept {
+  using traits = typename std::allocator_traits<A>::template rebind_traits<T>;
+  using pointer = typename traits::pointer;
+  typename traits::allocator_type alloc(a);
+  traits::destroy(alloc, t);
+  traits::deallocate(alloc, std::pointer_traits<pointer>::pointer_to(*t), 1);
+}
+
+// Storage for the allocator of allocator_copy and allocator_delete.
+// Allocators which are always equal and default constructible are not stored
+// at all, so that an indirect_value using std::allocator stays the size of a
+// pointer even though both its copier and deleter refer to an allocator.
+template <class A, bool Stateless =
+                       std::allocator_traits<A>::is_always_equal::value &&
+                       std::is_default_constructible_v<A>>
+class indirect_value_allocator_base {
+ protected:
+  indirect_value_allocator_base() = default;
+  indirect_value_allocator_base(const A& a) : a_(a) {}
+  const A& get() const noexcept { return a_; }
+  void set(const A& a) { a_ = a; }
+  A a_;
+};
+
+template <class A>
+class indirect_value_allocator_base<A, true> {
+ protected:
+  indirect_value_allocator_base() = default;
+  indirect_value_allocator_base(const A&) noexcept {}
+  A get() const noexcept { return A(); }
+  void set(const A&) noexcept {}
+};
+
+// A copier which allocates copies with an allocator.
+//
+// Copies are allocated with the allocator selected by
+// allocator_traits<A>::select_on_container_copy_construction. For most
+// allocators that is a copy of the allocator of the source, so copies reuse
+// the source's allocator. Copying an allocator_copy makes the same selection,
+// so the copier and deleter of a copied indirect_value agree with the
+// allocator that allocated its owned object.
+template <class T, class A = std::allocator<T>>
+class allocator_copy : private indirect_value_allocator_base<A> {
+  using base = indirect_value_allocator_base<A>;
+  using traits = std::allocator_traits<A>;
+
+  static_assert(std::is_same_v<typename traits::value_type, T>,
+                "allocator_copy requires an allocator for T");
+
+ public:
+  using allocator_type = A;
+
+  allocator_copy() = default;
+  explicit allocator_copy(const A& a) noexcept : base(a) {}
+  allocator_copy(const allocator_copy& other)
+      : base(traits::select_on_container_copy_construction(other.get())) {}
+  allocator_copy(allocator_copy&&) noexcept = default;
+  allocator_copy& operator=(const allocator_copy& other) {
+    base::set(traits::select_on_container_copy_construction(other.get()));
+    return *this;
+  }
+  allocator_copy& operator=(allocator_copy&&) noexcept = default;
+
+  allocator_type get_allocator() const noexcept { return base::get(); }
+
+  T* operator()(const T& t) const {
+    return _allocate_with<T>(
+        traits::select_on_container_copy_construction(base::get()), t);
+  }
+};
+
+// A deleter which destroys and deallocates with an allocator.
+//
+// See allocator_copy for how the allocator is selected when copying.
+template <class T, class A = std::allocator<T>>
+class allocator_delete : private indirect_value_allocator_base<A> {
+  using base = indirect_value_allocator_base<A>;
+  using traits = std::allocator_traits<A>;
+
+  static_assert(std::is_same_v<typename traits::value_type, T>,
+                "allocator_delete requires an allocator for T");
+
+ public:
+  using allocator_type = A;
+
+  allocator_delete() = default;
+  explicit allocator_delete(const A& a) noexcept : base(a) {}
+  allocator_delete(const allocator_delete& other)
+      : base(traits::select_on_container_copy_construction(other.get())) {}
+  allocator_delete(allocator_delete&&) noexcept = default;
+  allocator_delete& operator=(const allocator_delete& other) {
+    base::set(traits::select_on_container_copy_construction(other.get()));
+    return *this;
+  }
+  allocator_delete& operator=(allocator_delete&&) noexcept = default;
+
+  allocator_type get_allocator() const noexcept { return base::get(); }
+
+  void operator()(T* t) const noexcept { _deallocate_with(base::get(), t); }
+};
+
+#ifdef __cpp_lib_memory_resource
+// polymorphic_allocator selects the default memory resource on copy
+// construction, whatever its own resource is, so copying needs no state and
+// only the deleter has to remember the resource of the owned object. This
+// keeps pmr::indirect_value the size of two pointers.
+template <class T>
+class allocator_copy<T, std::pmr::polymorphic_allocator<T>> {
+ public:
+  using allocator_type = std::pmr::polymorphic_allocator<T>;
+
+  allocator_copy() = default;
+  explicit allocator_copy(const allocator_type&) noexcept {}
+
+  allocator_type get_allocator() const noexcept {
+    return allocator_type().select_on_container_copy_construction();
+  }
+
+  T* operator()(const T& t) const {
+    return _allocate_with<T>(get_allocator(), t);
+  }
+};
+
+template <class T>
+class allocator_delete<T, std::pmr::polymorphic_allocator<T>> {
+ public:
+  using allocator_type = std::pmr::polymorphic_allocator<T>;
+
+  allocator_delete() = default;
+  explicit allocator_delete(const allocator_type& a) noexcept
+      : resource_(a.resource()) {}
+  allocator_delete(const allocator_delete&) noexcept
+      : resource_(select_on_copy()) {}
+  allocator_delete(allocator_delete&&) noexcept = default;
+  allocator_delete& operator=(const allocator_delete&) noexcept {
+    resource_ = select_on_copy();
+    return *this;
+  }
+  allocator_delete& operator=(allocator_delete&&) noexcept = default;
+
+  allocator_type get_allocator() const noexcept {
+    return allocator_type(resource_);
+  }
+
+  void operator()(T* t) const noexcept { _deallocate_with(get_allocator(), t); }
+
+ private:
+  static std::pmr::memory_resource* select_on_copy() noexcept {
+    return allocator_type().select_on_container_copy_construction().resource();
+  }
+
+  std::pmr::memory_resource* resource_ = std::pmr::get_default_resource();
+};
+#endif
+
+// A stack of trivially copyable entries for the work lists of one thread.
+// Up to local_capacity entries are held without allocating. The stack is
+// trivially destructible, so a thread_local stack stays usable while other
+// thread-local objects are destroyed.
+template <class E>
+class _work_stack {
+ public:
+  static constexpr std::size_t local_capacity = 32;
+
+  // Returns false, leaving the stack unchanged, if no memory is available.
+  bool push(const E& e) noexcept {
+    if (size_ == capacity()) {
+      const std::size_t capacity = 2 * size_;
+      auto* heap = static_cast<E*>(std::malloc(capacity * sizeof(E)));
+      if (!heap) return false;
+      std::memcpy(heap, data(), size_ * sizeof(E));
+      std::free(heap_);
+      heap_ = heap;
+      heap_capacity_ = capacity;
+    }
+    data()[size_++] = e;
+    return true;
+  }
+
+  bool pop(E& e) noexcept {
+    if (size_ == 0) return false;
+    e = data()[--size_];
+    return true;
+  }
+
+  E* begin() noexcept { return data(); }
+  E* end() noexcept { return data() + size_; }
+
+  // Empties the stack and frees any memory it has allocated.
+  void clear() noexcept {
+    std::free(heap_);
+    heap_ = nullptr;
+    heap_capacity_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  E* data() noexcept { return heap_ ? heap_ : local_; }
+  std::size_t capacity() const noexcept {
+    return heap_ ? heap_capacity_ : local_capacity;
+  }
+
+  E local_[local_capacity];
+  E* heap_ = nullptr;
+  std::size_t heap_capacity_ = 0;
+  std::size_t size_ = 0;
+};
+
+struct _deferred_delete {
+  void* p;
+  void (*destroy)(void*) noexcept;
+};
+
+struct _deferred_deletes_t {
+  _work_stack<_deferred_delete> queue;
+  bool draining = false;
+};
+
+inline thread_local _deferred_deletes_t _deferred_deletes;
+
+// Destroys p with destroy. A call made while another call on the same thread
+// is destroying an object only queues p, and the outermost call destroys the
+// queued objects one after another, so destroying nested objects does not
+// recurse. If the queue cannot grow, p is destroyed recursively instead.
+inline void _destroy_iteratively(void* p,
+                                 void (*destroy)(void*) noexcept) noexcept {
+  _deferred_deletes_t& deletes = _deferred_deletes;
+  if (deletes.draining) {
+    if (!deletes.queue.push({p, destroy})) destroy(p);
+    return;
+  }
+  deletes.draining = true;
+  destroy(p);
+  for (_deferred_delete d; deletes.queue.pop(d);) d.destroy(d.p);
+  deletes.queue.clear();
+  deletes.draining = false;
+}
+
+// A deleter which destroys owned objects without recursing into the
+// indirect_values they own.
+//
+// Destroying a linked list or tree whose nodes own each other through
+// indirect_value<Node> with the default deleter recurses once per level, so
+// a long chain overflows the stack. When an iterative_delete is invoked
+// while another iterative_delete on the same thread is destroying an object,
+// it only queues its object, and the outermost call destroys the queued
+// objects one after another. The call depth is then constant, whatever the
+// depth of the structure.
+//
+// Queued objects of any type are destroyed by the outermost call, so nodes of
+// different types may use iterative_delete together. Objects are destroyed
+// in no particular order relative to their siblings; each object is still
+// destroyed after its owner's destructor has started. If the queue cannot
+// grow, the object is destroyed recursively instead.
+template <class T>
+struct iterative_delete {
+  void operator()(T* t) const noexcept { _destroy_iteratively(t, &destroy); }
+
+ private:
+  static void destroy(void* p) noexcept { delete static_cast<T*>(p); }
+};
+
+// Selects the constructor of indirect_value which default-initializes the
+// owned object, for make_indirect_value_for_overwrite.
+struct _for_overwrite_t {
+  explicit _for_overwrite_t() = default;
+};
+
+template <class D, class = void>
+inline constexpr bool _has_allocator_type_v = false;
+
+template <class D>
+inline constexpr bool
+    _has_allocator_type_v<D, std::void_t<typename D::allocator_type>> = true;
+
+// A copier which allocates its copies from storage that only one deleter can
+// free names that deleter as its member type deleter_type, and the deleter
+// names the copier as its member type copier_type. indirect_value rejects any
+// other pairing of them, which would free owned objects with the wrong
+// deleter, or leak them.
+template <class C, class D, class = void>
+inline constexpr bool _copier_pairs_with_v = true;
+
+template <class C, class D>
+inline constexpr bool
+    _copier_pairs_with_v<C, D, std::void_t<typename C::deleter_type>> =
+        std::is_same_v<typename C::deleter_type, D>;
+
+template <class D, class C, class = void>
+inline constexpr bool _deleter_pairs_with_v = true;
+
+template <class D, class C>
+inline constexpr bool
+    _deleter_pairs_with_v<D, C, std::void_t<typename D::copier_type>> =
+        std::is_same_v<typename D::copier_type, C>;
+
+template <class C, class D>
+inline constexpr bool _pairs_with_v =
+    _copier_pairs_with_v<C, D> && _deleter_pairs_with_v<D, C>;
+
 template <class T, class C = default_copy<T>, class D = std::default_delete<T>>
 class ISOCPP_P1950_EMPTY_BASES indirect_value
     : private indirect_value_copy_base<C>,
       private indirect_value_delete_base<D> {
+  static_assert(_pairs_with_v<C, D>,
+                "the copier and deleter of an indirect_value must be used "
+                "together: the deleter_type of the copier, or the copier_type "
+                "of the deleter, names the other");
+
   using copy_base = indirect_value_copy_base<C>;
   using delete_base = indirect_value_delete_base<D>;
 
@@ -97,21 +572,47 @@ class ISOCPP_P1950_EMPTY_BASES indirect_value
 
   template <class... Ts>
   explicit indirect_value(std::in_place_t, Ts&&... ts)
-      : ptr_(new T(std::forward<Ts>(ts)...)) {}
+      : ptr_(make_value(std::forward<Ts>(ts)...)) {}
+
+  explicit indirect_value(_for_overwrite_t tag) : ptr_(make_value(tag)) {}
+
+  // Allocator-extended constructor. The copier and deleter are both
+  // constructed from the allocator, and the owned object is allocated through
+  // the deleter's allocator.
+  template <class A, class... Ts,
+            class = std::enable_if_t<std::is_constructible_v<C, const A&> &&
+                                     std::is_constructible_v<D, const A&>>>
+  indirect_value(std::allocator_arg_t, const A& a, Ts&&... ts)
+      : copy_base(C(a)),
+        delete_base(D(a)),
+        ptr_(make_value(std::forward<Ts>(ts)...)) {}
 
   template <class U, class = std::enable_if_t<std::is_same_v<T, U>>>
   explicit indirect_value(U* u, C c = C{}, D d = D{}) noexcept
-      : copy_base(std::move(c)), delete_base(std::move(d)), ptr_(u) {}
+      : copy_base(std::move(c)), delete_base(std::move(d)), ptr_(u) {
+    if (ptr_) _instrumentation::created(ptr_);
+  }
 
   indirect_value(const indirect_value& i)
-      : copy_base(i.get_c()), delete_base(i.get_d()), ptr_(i.make_raw_copy()) {}
+      : copy_base(i.get_c()), delete_base(i.get_d()), ptr_(i.make_raw_copy()) {
+    if (ptr_) _instrumentation::copied(ptr_);
+  }
 
   indirect_value(indirect_value&& i) noexcept
       : copy_base(std::move(i)),
         delete_base(std::move(i)),
-        ptr_(std::exchange(i.ptr_, nullptr)) {}
+        ptr_(std::exchange(i.ptr_, nullptr)) {
+    if (ptr_) _instrumentation::moved(ptr_);
+  }
 
   indirect_value& operator=(const indirect_value& i) {
+    if constexpr (copy_assigns_in_place()) {
+      if (ptr_ && i.ptr_) {
+        *ptr_ = *i.ptr_;
+        _instrumentation::copy_assigned(ptr_);
+        return *this;
+      }
+    }
     // When copying T throws, *this will remain unchanged.
     // When assigning copy_base or delete_base throws,
     // ptr_ will be null.
@@ -120,6 +621,7 @@ class ISOCPP_P1950_EMPTY_BASES indirect_value
     copy_base::operator=(i);
     delete_base::operator=(i);
     ptr_ = temp_guard.release();
+    if (ptr_) _instrumentation::copied(ptr_);
     return *this;
   }
 
@@ -129,10 +631,29 @@ class ISOCPP_P1950_EMPTY_BASES indirect_value
       copy_base::operator=(std::move(i));
       delete_base::operator=(std::move(i));
       ptr_ = std::exchange(i.ptr_, nullptr);
+      if (ptr_) _instrumentation::moved(ptr_);
     }
     return *this;
   }
 
+  // Assigns to the owned object if there is one and it can be reused, and
+  // otherwise replaces it with one created as the in-place constructor does.
+  template <class U = T,
+            class = std::enable_if_t<std::is_same_v<
+                std::remove_cv_t<std::remove_reference_t<U>>, T>>>
+  indirect_value& operator=(U&& u) {
+    if constexpr (reuses_owned_object()) {
+      if (ptr_) {
+        *ptr_ = std::forward<U>(u);
+        return *this;
+      }
+    }
+    T* p = make_value(std::forward<U>(u));
+    reset();
+    ptr_ = p;
+    return *this;
+  }
+
   ~indirect_value() { reset(); }
 
   T* operator->() noexcept { return ptr_; }
@@ -179,6 +700,48 @@ class ISOCPP_P1950_EMPTY_BASES indirect_value
 
   const deleter_type& get_deleter() const noexcept { return get_d(); }
 
+  // Replaces the owned object with one direct-non-list-initialized from ts.
+  // With the default copier and deleter, and a T which is not polymorphic or
+  // is final, an existing owned object is reused rather than freed: T is
+  // constructed in its storage when that cannot throw, and otherwise move
+  // assigned from a temporary when that cannot throw. Otherwise a new owned
+  // object is created through the deleter's allocator, if it has one, and
+  // the old one is destroyed by the deleter. If constructing T throws, *this
+  // is unchanged.
+  template <class... Ts>
+  T& emplace(Ts&&... ts) {
+    if constexpr (reuses_owned_object()) {
+      if (ptr_) {
+        if constexpr (std::is_nothrow_constructible_v<T, Ts...>) {
+          T* p = std::exchange(ptr_, nullptr);
+          _instrumentation::destroyed(p);
+          p->~T();
+          ptr_ = ::new (static_cast<void*>(p)) T(std::forward<Ts>(ts)...);
+          _instrumentation::created(ptr_);
+          return *ptr_;
+        } else if constexpr (std::is_nothrow_move_assignable_v<T>) {
+          *ptr_ = T(std::forward<Ts>(ts)...);
+          return *ptr_;
+        }
+      }
+    }
+    T* p = make_value(std::forward<Ts>(ts)...);
+    reset();
+    ptr_ = p;
+    return *ptr_;
+  }
+
+  void reset() noexcept {
+    if (ptr_) {
+      // Make sure to first set ptr_ to nullptr before calling the deleter.
+      // This will protect us in case that the deleter invokes some code
+      // which again accesses ptr_.
+      _instrumentation::destroyed(static_cast<const T*>(ptr_));
+      ISOCPP_P1950_PROBE(destroy, T, ptr_);
+      get_d()(std::exchange(ptr_, nullptr));
+    }
+  }
+
   void swap(indirect_value& rhs) noexcept(
       std::is_nothrow_swappable_v<C>&& std::is_nothrow_swappable_v<D>) {
     using std::swap;
@@ -200,16 +763,63 @@ class ISOCPP_P1950_EMPTY_BASES indirect_value
   D& get_d() noexcept { return delete_base::get(); }
   const D& get_d() const noexcept { return delete_base::get(); }
 
-  void reset() noexcept {
-    if (ptr_) {
-      // Make sure to first set ptr_ to nullptr before calling the deleter.
-      // This will protect us in case that the deleter invokes some code
-      // which again accesses ptr_.
-      get_d()(std::exchange(ptr_, nullptr));
+  // Whether the owned object may be assigned to, or destroyed and
+  // constructed again in its storage, instead of being replaced. Other
+  // copiers and deleters may own the storage or track the objects in it, and
+  // the owned object of an indirect_value of a polymorphic T may be of a
+  // derived type.
+  static constexpr bool reuses_owned_object() noexcept {
+    return std::is_same_v<C, default_copy<T>> &&
+           std::is_same_v<D, std::default_delete<T>> &&
+           (!std::is_polymorphic_v<T> || std::is_final_v<T>);
+  }
+
+  static constexpr bool copy_assigns_in_place() noexcept {
+    if constexpr (reuses_owned_object()) {
+      return std::is_copy_assignable_v<T> &&
+             (std::is_nothrow_copy_assignable_v<T> ||
+              enable_copy_assign_in_place<T>::value);
+    } else {
+      return false;
+    }
+  }
+
+  // Deleters which expose an allocator_type own the memory of the held
+  // object, so new objects are allocated with the deleter's allocator.
+  template <class... Ts>
+  T* make_value(Ts&&... ts) const {
+    T* p;
+    if constexpr (_has_allocator_type_v<D>) {
+      p = _allocate_with<T>(get_d().get_allocator(), std::forward<Ts>(ts)...);
+    } else {
+      p = new T(std::forward<Ts>(ts)...);
+    }
+    return created(p);
+  }
+
+  // As make_value(), but default-initializes the owned object.
+  T* make_value(_for_overwrite_t) const {
+    T* p;
+    if constexpr (_has_allocator_type_v<D>) {
+      p = _allocate_for_overwrite_with<T>(get_d().get_allocator());
+    } else {
+      p = new T;
     }
+    return created(p);
   }
 
-  T* make_raw_copy() const { return ptr_ ? get_c()(*ptr_) : nullptr; }
+  static T* created(T* p) noexcept {
+    _instrumentation::created(static_cast<const T*>(p));
+    ISOCPP_P1950_PROBE(allocate, T, p);
+    return p;
+  }
+
+  T* make_raw_copy() const {
+    if (!ptr_) return nullptr;
+    T* p = get_c()(*ptr_);
+    ISOCPP_P1950_PROBE(copy, T, p);
+    return p;
+  }
 
   std::unique_ptr<T, std::reference_wrapper<const D>> make_guarded_copy()
       const {
@@ -223,51 +833,195 @@ class ISOCPP_P1950_EMPTY_BASES indirect_value
 template <class T>
 indirect_value(T*) -> indirect_value<T>;
 
-// Relational operators between two indirect_values.
-template <class T1, class C1, class D1, class T2, class C2, class D2>
-bool operator==(const indirect_value<T1, C1, D1>& lhs,
-                const indirect_value<T2, C2, D2>& rhs) {
+// Creates an indirect_value owning a T direct-non-list-initialized with ts.
+template <class T, class... Ts,
+          class = std::enable_if_t<std::is_constructible_v<T, Ts...>>>
+indirect_value<T> make_indirect_value(Ts&&... ts) {
+  return indirect_value<T>(std::in_place, std::forward<Ts>(ts)...);
+}
+
+// Creates an indirect_value owning a default-initialized T. Unlike
+// make_indirect_value<T>(), which value-initializes, a trivial T is not
+// zeroed, which avoids the cost for large objects that are overwritten
+// straight away.
+template <class T,
+          class = std::enable_if_t<std::is_default_constructible_v<T>>>
+indirect_value<T> make_indirect_value_for_overwrite() {
+  return indirect_value<T>(_for_overwrite_t{});
+}
+
+template <class T, class A>
+using _rebind_alloc_t =
+    typename std::allocator_traits<A>::template rebind_alloc<T>;
+
+template <class T, class A>
+using _allocator_indirect_value =
+    indirect_value<T, allocator_copy<T, _rebind_alloc_t<T, A>>,
+                   allocator_delete<T, _rebind_alloc_t<T, A>>>;
+
+// Creates an indirect_value whose owned object, and every copy of it, is
+// allocated with (a rebound copy of) the allocator a.
+template <class T, class A, class... Ts>
+_allocator_indirect_value<T, A> allocate_indirect_value(const A& a,
+                                                        Ts&&... ts) {
+  return _allocator_indirect_value<T, A>(std::allocator_arg,
+                                         _rebind_alloc_t<T, A>(a),
+                                         std::forward<Ts>(ts)...);
+}
+
+#ifdef __cpp_lib_memory_resource
+namespace pmr {
+// An indirect_value which allocates its owned object from a
+// std::pmr::memory_resource. Copies are allocated from the default memory
+// resource, as for other containers using std::pmr::polymorphic_allocator.
+template <class T>
+using indirect_value = _allocator_indirect_value<
+    T, std::pmr::polymorphic_allocator<T>>;
+}  // namespace pmr
+#endif
+
+// A type is trivially relocatable if moving an object to new storage and
+// destroying the original is equivalent to copying its bytes and forgetting
+// the original. Trivially copyable types are trivially relocatable.
+// Specialise is_trivially_relocatable for other types where it holds.
+template <class T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template <class T>
+inline constexpr bool is_trivially_relocatable_v =
+    is_trivially_relocatable<T>::value;
+
+// An indirect_value is a pointer plus its copier and deleter; the owned
+// object does not refer back to it, so it relocates trivially whenever they
+// do.
+template <class T, class C, class D>
+struct is_trivially_relocatable<indirect_value<T, C, D>>
+    : std::bool_constant<is_trivially_relocatable_v<C> &&
+                         is_trivially_relocatable_v<D>> {};
+
+template <class T, class A>
+struct is_trivially_relocatable<allocator_copy<T, A>>
+    : is_trivially_relocatable<A> {};
+
+template <class T, class A>
+struct is_trivially_relocatable<allocator_delete<T, A>>
+    : is_trivially_relocatable<A> {};
+
+template <class T>
+struct is_trivially_relocatable<std::allocator<T>> : std::true_type {};
+
+#ifdef __cpp_lib_memory_resource
+template <class T>
+struct is_trivially_relocatable<std::pmr::polymorphic_allocator<T>>
+    : std::true_type {};
+#endif
+
+// Relocates the objects in [first, last) to the uninitialized storage
+// starting at d_first, leaving [first, last) as uninitialized storage.
+// Trivially relocatable objects are relocated with a single memcpy, so
+// growing a buffer of indirect_values does not run a move constructor and a
+// destructor per element. The ranges must not overlap. Returns the end of
+// the destination range.
+template <class T>
+T* uninitialized_relocate(T* first, T* last, T* d_first) noexcept {
+  static_assert(is_trivially_relocatable_v<T> ||
+                    std::is_nothrow_move_constructible_v<T>,
+                "uninitialized_relocate requires a trivially relocatable or "
+                "nothrow move constructible type");
+  if constexpr (is_trivially_relocatable_v<T>) {
+    const auto count = static_cast<std::size_t>(last - first);
+    if (count != 0) {
+      std::memcpy(static_cast<void*>(d_first),
+                  static_cast<const void*>(first), count * sizeof(T));
+    }
+    return d_first + count;
+  } else {
+    for (; first != last; ++first, ++d_first) {
+      ::new (static_cast<void*>(d_first)) T(std::move(*first));
+      first->~T();
+    }
+    return d_first;
+  }
+}
+
+// Comparisons.
+//
+// indirect_value, and the other class templates of this library which own
+// at most one object of their value_type, compare as std::optional does: an
+// empty one is equal to another empty one and to nullptr, and less than a
+// non-empty one or any value, and non-empty ones compare their owned
+// objects. A class template opts in to the operators below by specialising
+// _is_indirect_v, and its objects then also compare with those of the other
+// class templates which have, such as an indirect_value<int> with an
+// inline_indirect_value<int, N>.
+template <class>
+inline constexpr bool _is_indirect_v = false;
+
+template <class T, class C, class D>
+inline constexpr bool _is_indirect_v<indirect_value<T, C, D>> = true;
+
+template <class I>
+using _enable_if_indirect = std::enable_if_t<_is_indirect_v<I>, bool>;
+
+template <class I1, class I2>
+using _enable_if_both_indirect =
+    std::enable_if_t<_is_indirect_v<I1> && _is_indirect_v<I2>, bool>;
+
+// The value_type of I, if I is compared with a U which is not itself one of
+// the class templates above.
+template <class I, class U>
+using _indirect_value_type_t =
+    typename std::enable_if_t<_is_indirect_v<I> && !_is_indirect_v<U>,
+                              I>::value_type;
+
+// Relational operators between two indirect_values, or other class
+// templates as above.
+template <class I1, class I2>
+auto operator==(const I1& lhs, const I2& rhs)
+    -> _enable_if_both_indirect<I1, I2> {
   const bool leftHasValue = bool(lhs);
   return leftHasValue == bool(rhs) && (!leftHasValue || *lhs == *rhs);
 }
 
-template <class T1, class C1, class D1, class T2, class C2, class D2>
-bool operator!=(const indirect_value<T1, C1, D1>& lhs,
-                const indirect_value<T2, C2, D2>& rhs) {
+template <class I1, class I2>
+auto operator!=(const I1& lhs, const I2& rhs)
+    -> _enable_if_both_indirect<I1, I2> {
   const bool leftHasValue = bool(lhs);
   return leftHasValue != bool(rhs) || (leftHasValue && *lhs != *rhs);
 }
 
-template <class T1, class C1, class D1, class T2, class C2, class D2>
-bool operator<(const indirect_value<T1, C1, D1>& lhs,
-               const indirect_value<T2, C2, D2>& rhs) {
+template <class I1, class I2>
+auto operator<(const I1& lhs, const I2& rhs)
+    -> _enable_if_both_indirect<I1, I2> {
   return bool(rhs) && (!bool(lhs) || *lhs < *rhs);
 }
 
-template <class T1, class C1, class D1, class T2, class C2, class D2>
-bool operator>(const indirect_value<T1, C1, D1>& lhs,
-               const indirect_value<T2, C2, D2>& rhs) {
+template <class I1, class I2>
+auto operator>(const I1& lhs, const I2& rhs)
+    -> _enable_if_both_indirect<I1, I2> {
   return bool(lhs) && (!bool(rhs) || *lhs > *rhs);
 }
 
-template <class T1, class C1, class D1, class T2, class C2, class D2>
-bool operator<=(const indirect_value<T1, C1, D1>& lhs,
-                const indirect_value<T2, C2, D2>& rhs) {
+template <class I1, class I2>
+auto operator<=(const I1& lhs, const I2& rhs)
+    -> _enable_if_both_indirect<I1, I2> {
   return !bool(lhs) || (bool(rhs) && *lhs <= *rhs);
 }
 
-template <class T1, class C1, class D1, class T2, class C2, class D2>
-bool operator>=(const indirect_value<T1, C1, D1>& lhs,
-                const indirect_value<T2, C2, D2>& rhs) {
+template <class I1, class I2>
+auto operator>=(const I1& lhs, const I2& rhs)
+    -> _enable_if_both_indirect<I1, I2> {
   return !bool(rhs) || (bool(lhs) && *lhs >= *rhs);
 }
 
 #if defined(__cpp_lib_three_way_comparison) && defined(__cpp_lib_concepts)
-template <class T1, class C1, class D1, std::three_way_comparable_with<T1> T2,
-          class C2, class D2>
-std::compare_three_way_result_t<T1, T2> operator<=>(
-    const indirect_value<T1, C1, D1>& lhs,
-    const indirect_value<T2, C2, D2>& rhs) {
+template <class I1, class I2>
+requires _is_indirect_v<I1> && _is_indirect_v<I2> &&
+    std::three_way_comparable_with<typename I1::value_type,
+                                   typename I2::value_type>
+        std::compare_three_way_result_t<typename I1::value_type,
+                                        typename I2::value_type>
+        operator<=>(const I1& lhs, const I2& rhs) {
   if (lhs && rhs) {
     return *lhs <=> *rhs;
   }
@@ -276,70 +1030,78 @@ std::compare_three_way_result_t<T1, T2> operator<=>(
 #endif
 
 // Comparisons with nullptr_t.
-template <class T, class C, class D>
-bool operator==(const indirect_value<T, C, D>& lhs, std::nullptr_t) noexcept {
+template <class I>
+auto operator==(const I& lhs, std::nullptr_t) noexcept
+    -> _enable_if_indirect<I> {
   return !lhs;
 }
 
 #if defined(__cpp_lib_three_way_comparison) && defined(__cpp_lib_concepts)
-template <class T, class C, class D>
-std::strong_ordering operator<=>(const indirect_value<T, C, D>& lhs,
-                                 std::nullptr_t) {
+template <class I>
+requires _is_indirect_v<I> std::strong_ordering operator<=>(const I& lhs,
+                                                            std::nullptr_t) {
   return bool(lhs) <=> false;
 }
 #else
-template <class T, class C, class D>
-bool operator==(std::nullptr_t, const indirect_value<T, C, D>& rhs) noexcept {
+template <class I>
+auto operator==(std::nullptr_t, const I& rhs) noexcept
+    -> _enable_if_indirect<I> {
   return !rhs;
 }
 
-template <class T, class C, class D>
-bool operator!=(const indirect_value<T, C, D>& lhs, std::nullptr_t) noexcept {
+template <class I>
+auto operator!=(const I& lhs, std::nullptr_t) noexcept
+    -> _enable_if_indirect<I> {
   return bool(lhs);
 }
 
-template <class T, class C, class D>
-bool operator!=(std::nullptr_t, const indirect_value<T, C, D>& rhs) noexcept {
+template <class I>
+auto operator!=(std::nullptr_t, const I& rhs) noexcept
+    -> _enable_if_indirect<I> {
   return bool(rhs);
 }
 
-template <class T, class C, class D>
-bool operator<(const indirect_value<T, C, D>&, std::nullptr_t) noexcept {
+template <class I>
+auto operator<(const I&, std::nullptr_t) noexcept -> _enable_if_indirect<I> {
   return false;
 }
 
-template <class T, class C, class D>
-bool operator<(std::nullptr_t, const indirect_value<T, C, D>& rhs) noexcept {
+template <class I>
+auto operator<(std::nullptr_t, const I& rhs) noexcept
+    -> _enable_if_indirect<I> {
   return bool(rhs);
 }
 
-template <class T, class C, class D>
-bool operator>(const indirect_value<T, C, D>& lhs, std::nullptr_t) noexcept {
+template <class I>
+auto operator>(const I& lhs, std::nullptr_t) noexcept
+    -> _enable_if_indirect<I> {
   return bool(lhs);
 }
 
-template <class T, class C, class D>
-bool operator>(std::nullptr_t, const indirect_value<T, C, D>&) noexcept {
+template <class I>
+auto operator>(std::nullptr_t, const I&) noexcept -> _enable_if_indirect<I> {
   return false;
 }
 
-template <class T, class C, class D>
-bool operator<=(const indirect_value<T, C, D>& lhs, std::nullptr_t) noexcept {
+template <class I>
+auto operator<=(const I& lhs, std::nullptr_t) noexcept
+    -> _enable_if_indirect<I> {
   return !lhs;
 }
 
-template <class T, class C, class D>
-bool operator<=(std::nullptr_t, const indirect_value<T, C, D>&) noexcept {
+template <class I>
+auto operator<=(std::nullptr_t, const I&) noexcept -> _enable_if_indirect<I> {
   return true;
 }
 
-template <class T, class C, class D>
-bool operator>=(const indirect_value<T, C, D>&, std::nullptr_t) noexcept {
+template <class I>
+auto operator>=(const I&, std::nullptr_t) noexcept -> _enable_if_indirect<I> {
   return true;
 }
 
-template <class T, class C, class D>
-bool operator>=(std::nullptr_t, const indirect_value<T, C, D>& rhs) noexcept {
+template <class I>
+auto operator>=(std::nullptr_t, const I& rhs) noexcept
+    -> _enable_if_indirect<I> {
   return !rhs;
 }
 #endif
@@ -379,108 +1141,104 @@ using _enable_if_comparable_with_greater_equal =
     _enable_if_convertible_to_bool<decltype(std::declval<const LHS&>() >=
                                             std::declval<const RHS&>())>;
 
-template <class T, class C, class D, class U>
-auto operator==(const indirect_value<T, C, D>& lhs, const U& rhs)
-    -> _enable_if_comparable_with_equal<T, U> {
+template <class I, class U>
+auto operator==(const I& lhs, const U& rhs)
+    -> _enable_if_comparable_with_equal<_indirect_value_type_t<I, U>, U> {
   return lhs && *lhs == rhs;
 }
 
-template <class T, class C, class D, class U>
-auto operator==(const T& lhs, const indirect_value<U, C, D>& rhs)
-    -> _enable_if_comparable_with_equal<T, U> {
+template <class T, class I>
+auto operator==(const T& lhs, const I& rhs)
+    -> _enable_if_comparable_with_equal<T, _indirect_value_type_t<I, T>> {
   return rhs && lhs == *rhs;
 }
 
-template <class T, class C, class D, class U>
-auto operator!=(const indirect_value<T, C, D>& lhs, const U& rhs)
-    -> _enable_if_comparable_with_not_equal<T, U> {
+template <class I, class U>
+auto operator!=(const I& lhs, const U& rhs)
+    -> _enable_if_comparable_with_not_equal<_indirect_value_type_t<I, U>, U> {
   return !lhs || *lhs != rhs;
 }
 
-template <class T, class C, class D, class U>
-auto operator!=(const T& lhs, const indirect_value<U, C, D>& rhs)
-    -> _enable_if_comparable_with_not_equal<T, U> {
+template <class T, class I>
+auto operator!=(const T& lhs, const I& rhs)
+    -> _enable_if_comparable_with_not_equal<T, _indirect_value_type_t<I, T>> {
   return !rhs || lhs != *rhs;
 }
 
-template <class T, class C, class D, class U>
-auto operator<(const indirect_value<T, C, D>& lhs, const U& rhs)
-    -> _enable_if_comparable_with_less<T, U> {
+template <class I, class U>
+auto operator<(const I& lhs, const U& rhs)
+    -> _enable_if_comparable_with_less<_indirect_value_type_t<I, U>, U> {
   return !lhs || *lhs < rhs;
 }
 
-template <class T, class C, class D, class U>
-auto operator<(const T& lhs, const indirect_value<U, C, D>& rhs)
-    -> _enable_if_comparable_with_less<T, U> {
+template <class T, class I>
+auto operator<(const T& lhs, const I& rhs)
+    -> _enable_if_comparable_with_less<T, _indirect_value_type_t<I, T>> {
   return rhs && lhs < *rhs;
 }
 
-template <class T, class C, class D, class U>
-auto operator>(const indirect_value<T, C, D>& lhs, const U& rhs)
-    -> _enable_if_comparable_with_greater<T, U> {
+template <class I, class U>
+auto operator>(const I& lhs, const U& rhs)
+    -> _enable_if_comparable_with_greater<_indirect_value_type_t<I, U>, U> {
   return lhs && *lhs > rhs;
 }
 
-template <class T, class C, class D, class U>
-auto operator>(const T& lhs, const indirect_value<U, C, D>& rhs)
-    -> _enable_if_comparable_with_greater<T, U> {
+template <class T, class I>
+auto operator>(const T& lhs, const I& rhs)
+    -> _enable_if_comparable_with_greater<T, _indirect_value_type_t<I, T>> {
   return !rhs || lhs > *rhs;
 }
 
-template <class T, class C, class D, class U>
-auto operator<=(const indirect_value<T, C, D>& lhs, const U& rhs)
-    -> _enable_if_comparable_with_less_equal<T, U> {
+template <class I, class U>
+auto operator<=(const I& lhs, const U& rhs)
+    -> _enable_if_comparable_with_less_equal<_indirect_value_type_t<I, U>,
+                                             U> {
   return !lhs || *lhs <= rhs;
 }
 
-template <class T, class C, class D, class U>
-auto operator<=(const T& lhs, const indirect_value<U, C, D>& rhs)
-    -> _enable_if_comparable_with_less_equal<T, U> {
+template <class T, class I>
+auto operator<=(const T& lhs, const I& rhs)
+    -> _enable_if_comparable_with_less_equal<T,
+                                             _indirect_value_type_t<I, T>> {
   return rhs && lhs <= *rhs;
 }
 
-template <class T, class C, class D, class U>
-auto operator>=(const indirect_value<T, C, D>& lhs, const U& rhs)
-    -> _enable_if_comparable_with_greater_equal<T, U> {
+template <class I, class U>
+auto operator>=(const I& lhs, const U& rhs)
+    -> _enable_if_comparable_with_greater_equal<_indirect_value_type_t<I, U>,
+                                                U> {
   return lhs && *lhs >= rhs;
 }
 
-template <class T, class C, class D, class U>
-auto operator>=(const T& lhs, const indirect_value<U, C, D>& rhs)
-    -> _enable_if_comparable_with_greater_equal<T, U> {
+template <class T, class I>
+auto operator>=(const T& lhs, const I& rhs)
+    -> _enable_if_comparable_with_greater_equal<
+        T, _indirect_value_type_t<I, T>> {
   return !rhs || lhs >= *rhs;
 }
 
 #if defined(__cpp_lib_three_way_comparison) && defined(__cpp_lib_concepts)
-
-template <class>
-inline constexpr bool _is_indirect_value_v = false;
-
-template <class T, class C, class D>
-inline constexpr bool _is_indirect_value_v<indirect_value<T, C, D>> = true;
-
-template <class T, class C, class D, class U>
-requires(!_is_indirect_value_v<U>) &&
-    std::three_way_comparable_with<T, U> std::compare_three_way_result_t<T, U>
-    operator<=>(const indirect_value<T, C, D>& lhs, const U& rhs) {
+template <class I, class U>
+requires _is_indirect_v<I> && (!_is_indirect_v<U>) &&
+    std::three_way_comparable_with<typename I::value_type, U>
+        std::compare_three_way_result_t<typename I::value_type, U>
+        operator<=>(const I& lhs, const U& rhs) {
   return bool(lhs) ? *lhs <=> rhs : std::strong_ordering::less;
 }
 #endif
 
-template <class IndirectValue, bool Enabled>
+template <class IndirectValue, bool Enabled,
+          class VTHash = std::hash<typename IndirectValue::value_type>>
 struct _conditionally_enabled_hash {
-  using VTHash = std::hash<typename IndirectValue::value_type>;
-
   std::size_t operator()(const IndirectValue& key) const
       noexcept(noexcept(VTHash{}(*key))) {
     return key ? VTHash{}(*key) : 0;
   }
 };
 
-template <class T>
-struct _conditionally_enabled_hash<T,
-                                   false> {  // conditionally disabled hash
-                                             // base
+template <class T, class VTHash>
+struct _conditionally_enabled_hash<T, false, VTHash> {  // conditionally
+                                                        // disabled hash base
   _conditionally_enabled_hash() = delete;
   _conditionally_enabled_hash(const _conditionally_enabled_hash&) = delete;
   _conditionally_enabled_hash& operator=(const _conditionally_enabled_hash&) =
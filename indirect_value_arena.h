@@ -0,0 +1,327 @@
+#ifndef ISOCPP_P1950_INDIRECT_VALUE_ARENA_H
+#define ISOCPP_P1950_INDIRECT_VALUE_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "indirect_value.h"
+
+namespace isocpp_p1950 {
+
+// A monotonic arena, which hands out memory from large blocks by bumping a
+// pointer, and frees all of it at once when released or destroyed.
+//
+// Blocks start at initial_block_size and double up to max_block_size, so n
+// bytes take O(log n) allocations until blocks reach their maximum size.
+// An arena is not thread-safe.
+class arena {
+ public:
+  static constexpr std::size_t default_initial_block_size = 4 * 1024;
+  static constexpr std::size_t max_block_size = 1024 * 1024;
+
+  explicit arena(
+      std::size_t initial_block_size = default_initial_block_size) noexcept
+      : initial_block_size_(initial_block_size),
+        next_block_size_(initial_block_size) {}
+
+  arena(const arena&) = delete;
+  arena& operator=(const arena&) = delete;
+
+  ~arena() { release(); }
+
+  void* allocate(std::size_t size, std::size_t align) {
+    char* p = blocks_ ? align_up(next_, align) : nullptr;
+    if (!p || p > end_ || size > static_cast<std::size_t>(end_ - p)) {
+      const std::size_t block_size =
+          std::max(next_block_size_, sizeof(block) + align + size);
+      void* memory = ::operator new(block_size);
+      blocks_ = ::new (memory) block{blocks_, block_size};
+      next_ = reinterpret_cast<char*>(blocks_) + sizeof(block);
+      end_ = reinterpret_cast<char*>(blocks_) + block_size;
+      next_block_size_ = std::min(2 * next_block_size_, max_block_size);
+      p = align_up(next_, align);
+    }
+    next_ = p + size;
+    return p;
+  }
+
+  // Frees all the memory of the arena. Objects in it are not destroyed.
+  void release() noexcept {
+    while (block* b = blocks_) {
+      blocks_ = b->next;
+      ::operator delete(static_cast<void*>(b), b->size);
+    }
+    next_ = end_ = nullptr;
+    next_block_size_ = initial_block_size_;
+  }
+
+  // Whether p points into memory handed out by this arena.
+  bool owns(const void* p) const noexcept {
+    const auto address = reinterpret_cast<std::uintptr_t>(p);
+    for (const block* b = blocks_; b; b = b->next) {
+      const auto first = reinterpret_cast<std::uintptr_t>(b) + sizeof(block);
+      if (address >= first &&
+          address < reinterpret_cast<std::uintptr_t>(b) + b->size) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  struct alignas(std::max_align_t) block {
+    block* next;
+    std::size_t size;
+  };
+
+  static char* align_up(char* p, std::size_t align) noexcept {
+    const auto address = reinterpret_cast<std::uintptr_t>(p);
+    return p + ((align - address % align) % align);
+  }
+
+  block* blocks_ = nullptr;
+  char* next_ = nullptr;
+  char* end_ = nullptr;
+  std::size_t initial_block_size_;
+  std::size_t next_block_size_;
+};
+
+// An allocator which allocates from an arena, and never deallocates.
+template <class T>
+class arena_allocator {
+ public:
+  using value_type = T;
+
+  explicit arena_allocator(arena& a) noexcept : arena_(&a) {}
+  template <class U>
+  arena_allocator(const arena_allocator<U>& other) noexcept
+      : arena_(&other.get_arena()) {}
+
+  T* allocate(std::size_t n) {
+    if (n > static_cast<std::size_t>(-1) / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T*, std::size_t) noexcept {}
+
+  arena& get_arena() const noexcept { return *arena_; }
+
+  template <class U>
+  friend bool operator==(const arena_allocator& a,
+                         const arena_allocator<U>& b) noexcept {
+    return &a.get_arena() == &b.get_arena();
+  }
+
+  template <class U>
+  friend bool operator!=(const arena_allocator& a,
+                         const arena_allocator<U>& b) noexcept {
+    return !(a == b);
+  }
+
+ private:
+  arena* arena_;
+};
+
+template <class T>
+class arena_delete;
+
+// A copier which allocates copies from an arena.
+//
+// An arena_copy is bound to its arena on construction, and copying it
+// copies the binding, so an indirect_value copied from one in an arena, or
+// copy assigned from one, allocates its owned object from the same arena as
+// the source. There is no arena to default to, so arena_copy, and an
+// indirect_value using it, are not default constructible.
+//
+// Copies in an arena must be destroyed by arena_delete, which in turn can
+// only destroy objects in an arena, so indirect_value does not compile with
+// either of them paired with any other copier or deleter.
+template <class T>
+class arena_copy {
+ public:
+  using allocator_type = arena_allocator<T>;
+  using deleter_type = arena_delete<T>;
+
+  explicit arena_copy(arena& a) noexcept : arena_(&a) {}
+  template <class U>
+  explicit arena_copy(const arena_allocator<U>& a) noexcept
+      : arena_(&a.get_arena()) {}
+
+  allocator_type get_allocator() const noexcept {
+    return allocator_type(*arena_);
+  }
+
+  T* operator()(const T& t) const {
+    return _allocate_with<T>(get_allocator(), t);
+  }
+
+ private:
+  arena* arena_;
+};
+
+// A deleter for owned objects allocated from an arena. It only destroys the
+// object, and does nothing at all for a trivially destructible T; the memory
+// is freed with the arena.
+template <class T>
+class arena_delete {
+ public:
+  using allocator_type = arena_allocator<T>;
+  using copier_type = arena_copy<T>;
+
+  explicit arena_delete(arena& a) noexcept : arena_(&a) {}
+  template <class U>
+  explicit arena_delete(const arena_allocator<U>& a) noexcept
+      : arena_(&a.get_arena()) {}
+
+  allocator_type get_allocator() const noexcept {
+    return allocator_type(*arena_);
+  }
+
+  void operator()(T* t) const noexcept {
+    if constexpr (!std::is_trivially_destructible_v<T>) t->~T();
+  }
+
+ private:
+  arena* arena_;
+};
+
+// An indirect_value whose owned object, and every copy of it, is allocated
+// from an arena. It must be destroyed or reset before the arena is
+// released, unless T is trivially destructible.
+template <class T>
+using arena_indirect_value = indirect_value<T, arena_copy<T>, arena_delete<T>>;
+
+// Creates an arena_indirect_value owning a T direct-non-list-initialized
+// with ts, allocated from a.
+template <class T, class... Ts,
+          class = std::enable_if_t<std::is_constructible_v<T, Ts...>>>
+arena_indirect_value<T> make_arena_indirect_value(arena& a, Ts&&... ts) {
+  return arena_indirect_value<T>(std::allocator_arg, arena_allocator<T>(a),
+                                 std::forward<Ts>(ts)...);
+}
+
+// Moves the owned objects of the arena_indirect_values in range, in the
+// order of the range, into one contiguous block allocated from a, and binds
+// all the arena_indirect_values, including empty ones, to a.
+//
+// After churn, the owned objects of a container are scattered over the
+// blocks of their arena, and a scan over them misses the cache on every
+// element. Compacting them lays them out for sequential access again. The
+// moved-from objects are destroyed.
+//
+// Only the owned objects themselves are moved. Anything else in their old
+// arena stays there: the owned objects of arena_indirect_value members of T,
+// which move with their pointers and deleters unchanged, and the objects of
+// any other container using that arena. The old arena can only be released
+// once nothing is left in it:
+//
+//   auto fresh = std::make_unique<arena>();
+//   compact(elements, *fresh);
+//   // Only if elements were all that was left in *current, and T holds no
+//   // arena_indirect_values of its own:
+//   current = std::move(fresh);  // Releases the previous arena.
+//
+// If moving an object throws, the objects before it have been compacted and
+// the others are unchanged.
+template <class Range>
+void compact(Range& range, arena& a) {
+  using element = std::remove_reference_t<decltype(*std::begin(range))>;
+  using T = typename element::value_type;
+  static_assert(std::is_same_v<element, arena_indirect_value<T>>,
+                "compact requires a range of arena_indirect_values");
+
+  std::size_t n = 0;
+  for (const auto& v : range) {
+    if (v) ++n;
+  }
+  T* block = n ? arena_allocator<T>(a).allocate(n) : nullptr;
+  for (auto& v : range) {
+    T* t = v ? ::new (static_cast<void*>(block++)) T(std::move(*v)) : nullptr;
+    v = arena_indirect_value<T>(t, arena_copy<T>(a), arena_delete<T>(a));
+  }
+}
+
+// Copies the owned objects of the indirect_values in [first, last) into one
+// contiguous block allocated from a, in order, and writes
+// arena_indirect_values owning the copies to out. Empty indirect_values are
+// copied as empty arena_indirect_values bound to a. Returns the end of the
+// output range.
+//
+// The copies are made with T's copy constructor, bypassing the copiers of
+// the sources, which should do nothing but copy construct a T. Objects of a
+// derived type which a copier would clone would be sliced to T instead, so T
+// must not be polymorphic unless it is final.
+//
+// Copying a container of indirect_values copies each owned object into an
+// allocation of its own. Copying into an arena instead takes one allocation
+// for all of them, and lays them out for sequential access, as compact
+// does, which suits snapshots of large containers.
+//
+// If copying an owned object throws, nothing has been written to out.
+template <class ForwardIt, class OutputIt>
+OutputIt copy_range(ForwardIt first, ForwardIt last, OutputIt out, arena& a) {
+  using T = typename std::iterator_traits<ForwardIt>::value_type::value_type;
+  static_assert(!std::is_polymorphic_v<T> || std::is_final_v<T>,
+                "copy_range copies owned objects as T, which would slice "
+                "objects of a derived type");
+
+  std::size_t n = 0;
+  for (ForwardIt i = first; i != last; ++i) {
+    if (*i) ++n;
+  }
+  T* const block = n ? arena_allocator<T>(a).allocate(n) : nullptr;
+  // The copies in [handed_out, constructed) are destroyed when unwinding.
+  T* constructed = block;
+  T* handed_out = block;
+  struct guard {
+    T*& handed_out;
+    T*& constructed;
+    ~guard() {
+      while (constructed != handed_out) (--constructed)->~T();
+    }
+  } unwind{handed_out, constructed};
+
+  for (ForwardIt i = first; i != last; ++i) {
+    if (*i) {
+      ::new (static_cast<void*>(constructed)) T(**i);
+      ++constructed;
+    }
+  }
+  for (ForwardIt i = first; i != last; ++i, ++out) {
+    T* t = *i ? handed_out++ : nullptr;
+    *out = arena_indirect_value<T>(t, arena_copy<T>(a), arena_delete<T>(a));
+  }
+  return out;
+}
+
+// Returns arena_indirect_values owning copies of the owned objects of the
+// indirect_values in range, allocated from a as by copy_range above.
+template <class Range>
+auto copy_range(const Range& range, arena& a) {
+  using T = typename std::remove_reference_t<decltype(
+      *std::begin(range))>::value_type;
+  std::vector<arena_indirect_value<T>> copies;
+  copies.reserve(std::size_t(std::distance(std::begin(range),
+                                           std::end(range))));
+  copy_range(std::begin(range), std::end(range), std::back_inserter(copies),
+             a);
+  return copies;
+}
+
+template <class T>
+struct is_trivially_relocatable<arena_copy<T>> : std::true_type {};
+
+template <class T>
+struct is_trivially_relocatable<arena_delete<T>> : std::true_type {};
+
+}  // namespace isocpp_p1950
+
+#endif  // ISOCPP_P1950_INDIRECT_VALUE_ARENA_H
@@ -0,0 +1,298 @@
+#ifndef ISOCPP_P1950_INDIRECT_VALUE_BATCH_H
+#define ISOCPP_P1950_INDIRECT_VALUE_BATCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "indirect_value.h"
+
+namespace isocpp_p1950 {
+
+// Owned objects of batched_copy and batched_delete are allocated in blocks.
+// A block holds one object, or all the objects placed in it by one copy, and
+// is freed when the last of its objects is destroyed.
+struct alignas(std::max_align_t) _batch_block {
+  std::atomic<std::size_t> live;
+  std::size_t size;
+  std::size_t align;
+};
+
+enum class _batch_state : unsigned char { constructed, pending, abandoned };
+
+// Every object in a block is preceded by a slot naming its block.
+struct _batch_slot {
+  _batch_block* block;
+  _batch_state state;
+};
+
+inline _batch_slot* _batch_slot_of(void* p) noexcept {
+  return reinterpret_cast<_batch_slot*>(static_cast<char*>(p) -
+                                        sizeof(_batch_slot));
+}
+
+inline char* _batch_align_up(char* p, std::size_t align) noexcept {
+  const auto address = reinterpret_cast<std::uintptr_t>(p);
+  return p + ((align - address % align) % align);
+}
+
+inline _batch_block* _batch_new_block(std::size_t size, std::size_t align,
+                                      std::size_t live) {
+  align = std::max(align, alignof(_batch_block));
+  void* memory = ::operator new(size, std::align_val_t(align));
+  return ::new (memory) _batch_block{{live}, size, align};
+}
+
+inline void _batch_release(_batch_block* b) noexcept {
+  if (b->live.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    const std::size_t size = b->size;
+    const std::size_t align = b->align;
+    b->~_batch_block();
+    ::operator delete(static_cast<void*>(b), size, std::align_val_t(align));
+  }
+}
+
+// Returns the first address after the block header of b where an object of
+// the given alignment, preceded by its slot, can be placed.
+inline char* _batch_first_object(_batch_block* b, std::size_t align) noexcept {
+  char* p = reinterpret_cast<char*>(b) + sizeof(_batch_block);
+  return _batch_align_up(p + sizeof(_batch_slot), align);
+}
+
+inline void* _batch_place(_batch_block* b, char* p, _batch_state state) {
+  ::new (static_cast<void*>(p - sizeof(_batch_slot))) _batch_slot{b, state};
+  return p;
+}
+
+// Allocates storage for a single object in a block of its own.
+inline void* _batch_allocate_single(std::size_t size, std::size_t align) {
+  align = std::max(align, alignof(_batch_slot));
+  const std::size_t block_size =
+      sizeof(_batch_block) + sizeof(_batch_slot) + align + size;
+  _batch_block* b = _batch_new_block(block_size, align, 1);
+  return _batch_place(b, _batch_first_object(b, align),
+                      _batch_state::constructed);
+}
+
+struct _deferred_copy {
+  const void* source;
+  void* target;
+  void (*construct)(const void*, void*);
+};
+
+// The state of the batched copy in progress on one thread, if any.
+//
+// Objects are placed one after another in the current block. Blocks start
+// at initial_block_size and double up to max_block_size, so copying n
+// objects takes O(log n) allocations until blocks reach their maximum size.
+// The copy holds a reference to its current block, so that the block is not
+// freed while objects may still be placed in it.
+class _batch_copy_session {
+ public:
+  static constexpr std::size_t initial_block_size = 4 * 1024;
+  static constexpr std::size_t max_block_size = 1024 * 1024;
+
+  bool active() const noexcept { return active_; }
+
+  void begin() noexcept { active_ = true; }
+
+  // Blocks of the next copy grow from initial_block_size again. The
+  // outermost copy allocates its own storage before calling begin, so the
+  // size is reset here rather than there.
+  void end() noexcept {
+    if (block_) _batch_release(block_);
+    block_ = nullptr;
+    next_ = end_ = nullptr;
+    next_block_size_ = initial_block_size;
+    active_ = false;
+  }
+
+  // Allocates pending storage for an object in the current block.
+  void* allocate(std::size_t size, std::size_t align) {
+    align = std::max(align, alignof(_batch_slot));
+    if (align > alignof(std::max_align_t) || 2 * size > max_block_size) {
+      void* p = _batch_allocate_single(size, align);
+      _batch_slot_of(p)->state = _batch_state::pending;
+      return p;
+    }
+    char* p = block_ ? _batch_align_up(next_ + sizeof(_batch_slot), align)
+                     : nullptr;
+    if (!p || p > end_ || size > static_cast<std::size_t>(end_ - p)) {
+      const std::size_t block_size = std::max(
+          next_block_size_,
+          sizeof(_batch_block) + sizeof(_batch_slot) + align + size);
+      // The new block starts referenced by this session only.
+      _batch_block* b = _batch_new_block(block_size, align, 1);
+      if (block_) _batch_release(block_);
+      block_ = b;
+      end_ = reinterpret_cast<char*>(b) + block_size;
+      next_block_size_ = std::min(2 * next_block_size_, max_block_size);
+      p = _batch_first_object(b, align);
+    }
+    block_->live.fetch_add(1, std::memory_order_relaxed);
+    next_ = p + size;
+    return _batch_place(block_, p, _batch_state::pending);
+  }
+
+  _work_stack<_deferred_copy> queue;
+
+ private:
+  _batch_block* block_ = nullptr;
+  char* next_ = nullptr;
+  char* end_ = nullptr;
+  std::size_t next_block_size_ = initial_block_size;
+  bool active_ = false;
+};
+
+inline thread_local _batch_copy_session _batch_copy;
+
+// Destroys, if constructed, and releases an object of batched_delete.
+template <class T>
+void _batch_destroy(void* p) noexcept {
+  _batch_slot* slot = _batch_slot_of(p);
+  switch (slot->state) {
+    case _batch_state::constructed:
+      static_cast<T*>(p)->~T();
+      break;
+    case _batch_state::pending:
+      if (_batch_copy.active()) {
+        // The copy in progress still refers to this storage; it is released
+        // when the copy reaches it.
+        slot->state = _batch_state::abandoned;
+        return;
+      }
+      break;
+    case _batch_state::abandoned:
+      break;
+  }
+  _batch_release(slot->block);
+}
+
+// The allocator of batched_delete, which allocates owned objects created in
+// place by indirect_value, each in a block of its own.
+template <class T>
+class batch_allocator {
+ public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  batch_allocator() = default;
+  template <class U>
+  batch_allocator(const batch_allocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    if (n != 1) throw std::bad_array_new_length();
+    return static_cast<T*>(_batch_allocate_single(sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, std::size_t) noexcept {
+    _batch_release(_batch_slot_of(p)->block);
+  }
+
+  template <class U>
+  friend bool operator==(const batch_allocator&,
+                         const batch_allocator<U>&) noexcept {
+    return true;
+  }
+
+  template <class U>
+  friend bool operator!=(const batch_allocator&,
+                         const batch_allocator<U>&) noexcept {
+    return false;
+  }
+};
+
+// A deleter for the owned objects of batched_copy. Like iterative_delete, it
+// destroys nested objects without recursion.
+template <class T>
+struct batched_delete {
+  using allocator_type = batch_allocator<T>;
+
+  allocator_type get_allocator() const noexcept { return {}; }
+
+  void operator()(T* t) const noexcept {
+    _destroy_iteratively(t, &_batch_destroy<T>);
+  }
+};
+
+// A copier for recursive structures, such as lists and trees whose nodes own
+// each other through indirect_value.
+//
+// With default_copy, copying a node copies its children from within its copy
+// constructor, so copying recurses once per level and allocates once per
+// node. When a batched_copy is invoked while another batched_copy on the
+// same thread is copying, it only allocates storage for its copy and queues
+// the construction, and the outermost call constructs the queued copies one
+// after another. Copying then uses constant stack, whatever the depth of the
+// structure, and all copies are placed next to each other, in the order they
+// are made, in a few large blocks.
+//
+// Copies are constructed after the copy constructor of their owner has
+// returned, so a copy constructor of T must not access the owned objects of
+// the indirect_values it has just copied. If copying throws, all copies made
+// so far are destroyed.
+//
+// The owned objects must be deleted with batched_delete.
+template <class T>
+struct batched_copy {
+  T* operator()(const T& t) const {
+    _batch_copy_session& session = _batch_copy;
+    void* p = session.allocate(sizeof(T), alignof(T));
+    if (session.active()) {
+      if (session.queue.push({&t, p, &construct})) return static_cast<T*>(p);
+      // Without room to queue it, copy recursively.
+      try {
+        construct(&t, p);
+      } catch (...) {
+        _batch_release(_batch_slot_of(p)->block);
+        throw;
+      }
+      return static_cast<T*>(p);
+    }
+
+    session.begin();
+    try {
+      construct(&t, p);
+      for (_deferred_copy c; session.queue.pop(c);) {
+        if (_batch_slot_of(c.target)->state == _batch_state::abandoned) {
+          _batch_release(_batch_slot_of(c.target)->block);
+        } else {
+          c.construct(c.source, c.target);
+        }
+      }
+    } catch (...) {
+      // Queued copies which are still pending are released by the deleters
+      // of their owners, once the session has ended.
+      for (_deferred_copy& c : session.queue) {
+        if (_batch_slot_of(c.target)->state == _batch_state::abandoned) {
+          _batch_release(_batch_slot_of(c.target)->block);
+        }
+      }
+      session.queue.clear();
+      session.end();
+      batched_delete<T>()(static_cast<T*>(p));
+      throw;
+    }
+    session.queue.clear();
+    session.end();
+    return static_cast<T*>(p);
+  }
+
+ private:
+  static void construct(const void* source, void* target) {
+    ::new (target) T(*static_cast<const T*>(source));
+    _batch_slot_of(target)->state = _batch_state::constructed;
+  }
+};
+
+template <class T>
+using batched_indirect_value =
+    indirect_value<T, batched_copy<T>, batched_delete<T>>;
+
+}  // namespace isocpp_p1950
+
+#endif  // ISOCPP_P1950_INDIRECT_VALUE_BATCH_H
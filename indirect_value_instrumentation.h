@@ -0,0 +1,847 @@
+#ifndef ISOCPP_P1950_INDIRECT_VALUE_INSTRUMENTATION_H
+#define ISOCPP_P1950_INDIRECT_VALUE_INSTRUMENTATION_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#define ISOCPP_P1950_HAS_CXXABI 1
+#endif
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define ISOCPP_P1950_HAS_EXECINFO 1
+#endif
+#endif
+
+// This header is included by indirect_value.h when ISOCPP_P1950_INSTRUMENTATION
+// is defined, and must not include it in turn.
+
+namespace isocpp_p1950 {
+
+// The counts of one owned type, summed over all threads. Bytes are counted as
+// sizeof the owned type; memory the owned objects hold themselves is not.
+struct type_statistics {
+  std::string type_name;
+  std::size_t size = 0;
+  std::int64_t live = 0;
+  std::int64_t peak = 0;
+  std::uint64_t created = 0;  // Including copies.
+  std::uint64_t copies = 0;
+  std::uint64_t copy_assignments = 0;
+  std::uint64_t moves = 0;
+  std::uint64_t destroyed = 0;
+
+  std::int64_t live_bytes() const noexcept {
+    return live * static_cast<std::int64_t>(size);
+  }
+  std::uint64_t bytes_copied() const noexcept {
+    return (copies + copy_assignments) * size;
+  }
+};
+
+enum _instrumented_event : std::size_t {
+  _event_created,
+  _event_copied,
+  _event_copy_assigned,
+  _event_moved,
+  _event_destroyed,
+  _event_count
+};
+
+struct _instrumented_type {
+  std::size_t id;
+  std::string name;
+  std::size_t size;
+  // The live count as last published by the threads; see record.
+  std::atomic<std::int64_t> live{0};
+  std::atomic<std::int64_t> peak{0};
+  // The counts of threads which have exited.
+  std::atomic<std::uint64_t> retired[_event_count] = {};
+
+  void publish(std::int64_t delta) noexcept {
+    const std::int64_t now =
+        live.fetch_add(delta, std::memory_order_relaxed) + delta;
+    std::int64_t p = peak.load(std::memory_order_relaxed);
+    while (now > p &&
+           !peak.compare_exchange_weak(p, now, std::memory_order_relaxed)) {
+    }
+  }
+};
+
+// The counts of one type on one thread. Only the owning thread writes them,
+// so they are updated without read-modify-write operations.
+struct _instrumentation_counters {
+  std::atomic<std::uint64_t> events[_event_count];
+  std::int64_t unpublished_live;  // Owning thread only.
+};
+
+// The counters of one thread, in pages allocated as types are first used.
+class _instrumentation_shard {
+ public:
+  static constexpr std::size_t page_size = 64;
+  static constexpr std::size_t max_pages = 256;
+
+  _instrumentation_shard() = default;
+  _instrumentation_shard(const _instrumentation_shard&) = delete;
+  _instrumentation_shard& operator=(const _instrumentation_shard&) = delete;
+
+  ~_instrumentation_shard() {
+    for (auto& page : pages_) delete[] page.load(std::memory_order_relaxed);
+  }
+
+  // Returns the counters of type id, if this shard has any.
+  _instrumentation_counters* find(std::size_t id) const noexcept {
+    if (id >= page_size * max_pages) return nullptr;
+    auto* page = pages_[id / page_size].load(std::memory_order_acquire);
+    return page ? page + id % page_size : nullptr;
+  }
+
+  // Returns the counters of type id, allocating them if needed, or nullptr.
+  // Called by the owning thread only.
+  _instrumentation_counters* get(std::size_t id) noexcept {
+    if (id >= page_size * max_pages) return nullptr;
+    auto& slot = pages_[id / page_size];
+    auto* page = slot.load(std::memory_order_relaxed);
+    if (!page) {
+      page = new (std::nothrow) _instrumentation_counters[page_size]();
+      if (!page) return nullptr;
+      slot.store(page, std::memory_order_release);
+    }
+    return page + id % page_size;
+  }
+
+ private:
+  std::atomic<_instrumentation_counters*> pages_[max_pages] = {};
+};
+
+class _instrumentation_registry {
+ public:
+  static _instrumented_type* add_type(std::string (*name)(),
+                                      std::size_t size) noexcept {
+    _instrumentation_registry& r = instance();
+    try {
+      std::lock_guard<std::mutex> lock(r.mutex_);
+      r.types_.reserve(r.types_.size() + 1);
+      auto* type = new _instrumented_type{r.types_.size(), name(), size};
+      r.types_.push_back(type);
+      return type;
+    } catch (...) {
+      return nullptr;
+    }
+  }
+
+  static _instrumentation_shard* add_shard() noexcept {
+    _instrumentation_registry& r = instance();
+    try {
+      std::lock_guard<std::mutex> lock(r.mutex_);
+      r.shards_.reserve(r.shards_.size() + 1);
+      auto* shard = new _instrumentation_shard;
+      r.shards_.push_back(shard);
+      return shard;
+    } catch (...) {
+      return nullptr;
+    }
+  }
+
+  // Folds the counts of an exiting thread into the retired counts.
+  static void retire_shard(_instrumentation_shard* shard) noexcept {
+    _instrumentation_registry& r = instance();
+    {
+      std::lock_guard<std::mutex> lock(r.mutex_);
+      for (_instrumented_type* type : r.types_) {
+        _instrumentation_counters* c = shard->find(type->id);
+        if (!c) continue;
+        for (std::size_t e = 0; e != _event_count; ++e) {
+          type->retired[e].fetch_add(
+              c->events[e].load(std::memory_order_relaxed),
+              std::memory_order_relaxed);
+        }
+        type->publish(c->unpublished_live);
+      }
+      r.shards_.erase(std::find(r.shards_.begin(), r.shards_.end(), shard));
+    }
+    delete shard;
+  }
+
+  static std::vector<type_statistics> statistics() {
+    _instrumentation_registry& r = instance();
+    std::lock_guard<std::mutex> lock(r.mutex_);
+    std::vector<type_statistics> result;
+    result.reserve(r.types_.size());
+    for (_instrumented_type* type : r.types_) {
+      result.push_back(statistics_locked(r, *type));
+    }
+    return result;
+  }
+
+  static type_statistics statistics(const _instrumented_type& type) {
+    _instrumentation_registry& r = instance();
+    std::lock_guard<std::mutex> lock(r.mutex_);
+    return statistics_locked(r, type);
+  }
+
+ private:
+  static type_statistics statistics_locked(
+      const _instrumentation_registry& r, const _instrumented_type& type) {
+    std::uint64_t events[_event_count];
+    for (std::size_t e = 0; e != _event_count; ++e) {
+      events[e] = type.retired[e].load(std::memory_order_relaxed);
+    }
+    for (const _instrumentation_shard* shard : r.shards_) {
+      if (const _instrumentation_counters* c = shard->find(type.id)) {
+        for (std::size_t e = 0; e != _event_count; ++e) {
+          events[e] += c->events[e].load(std::memory_order_relaxed);
+        }
+      }
+    }
+    type_statistics s;
+    s.type_name = type.name;
+    s.size = type.size;
+    s.created = events[_event_created] + events[_event_copied];
+    s.copies = events[_event_copied];
+    s.copy_assignments = events[_event_copy_assigned];
+    s.moves = events[_event_moved];
+    s.destroyed = events[_event_destroyed];
+    s.live = static_cast<std::int64_t>(s.created - s.destroyed);
+    s.peak = std::max(type.peak.load(std::memory_order_relaxed), s.live);
+    return s;
+  }
+
+  // Intentionally leaked, so that threads which outlive static destruction
+  // can still retire their shards.
+  static _instrumentation_registry& instance() {
+    static _instrumentation_registry* registry = new _instrumentation_registry;
+    return *registry;
+  }
+
+  std::mutex mutex_;
+  std::vector<_instrumented_type*> types_;
+  std::vector<_instrumentation_shard*> shards_;
+};
+
+inline thread_local _instrumentation_shard* _instrumentation_current = nullptr;
+inline thread_local bool _instrumentation_thread_exited = false;
+
+struct _instrumentation_thread_guard {
+  ~_instrumentation_thread_guard() {
+    if (_instrumentation_current) {
+      _instrumentation_registry::retire_shard(_instrumentation_current);
+    }
+    _instrumentation_current = nullptr;
+    _instrumentation_thread_exited = true;
+  }
+};
+
+inline thread_local _instrumentation_thread_guard _instrumentation_guard;
+
+inline _instrumentation_shard* _instrumentation_shard_of_thread() noexcept {
+  if (_instrumentation_shard* s = _instrumentation_current) return s;
+  // Events recorded while thread-local objects are destroyed go directly to
+  // the retired counts.
+  if (_instrumentation_thread_exited) return nullptr;
+  (void)&_instrumentation_guard;  // Registers the guard, which retires.
+  _instrumentation_current = _instrumentation_registry::add_shard();
+  return _instrumentation_current;
+}
+
+template <class T>
+std::string _instrumented_type_name() {
+#if defined(__cpp_rtti) || defined(__GXX_RTTI) || defined(_CPPRTTI)
+  const char* name = typeid(T).name();
+#ifdef ISOCPP_P1950_HAS_CXXABI
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (demangled) {
+    std::string result = demangled;
+    std::free(demangled);
+    return result;
+  }
+#endif
+  return name;
+#else
+  return "<type of size " + std::to_string(sizeof(T)) + ">";
+#endif
+}
+
+template <class T>
+_instrumented_type* _instrumented_type_of() noexcept {
+  static _instrumented_type* const type = _instrumentation_registry::add_type(
+      &_instrumented_type_name<T>, sizeof(T));
+  return type;
+}
+
+// An instrumentation policy for indirect_value which counts, for each owned
+// type, the live and peak number of owned objects and their bytes, and the
+// deep copies, copy assignments and moves made, with the bytes copied.
+//
+// Select it by compiling with
+//   -DISOCPP_P1950_INSTRUMENTATION=isocpp_p1950::counting_instrumentation
+// and read the counts with statistics, or print them with report, at any time
+// or, after report_at_exit, when the program exits.
+//
+// Each thread counts in counters of its own, which are summed when read, and
+// folded into totals when the thread exits, so counting takes no locks and
+// writes no shared cache lines, except while the live count of a type
+// reaches a new peak. Each thread publishes its change to the live count
+// when a new peak may have been reached, or once it has changed by
+// publish_threshold, so a peak may overstate the true one by less than
+// publish_threshold for each other thread creating and destroying objects
+// of the same type. Counts read while other threads are counting are not a
+// consistent snapshot.
+class counting_instrumentation {
+ public:
+  static constexpr std::int64_t publish_threshold = 64;
+
+  template <class T>
+  static void created(const T*) noexcept {
+    record<T>(_event_created, 1);
+  }
+  template <class T>
+  static void copied(const T*) noexcept {
+    record<T>(_event_copied, 1);
+  }
+  template <class T>
+  static void copy_assigned(const T*) noexcept {
+    record<T>(_event_copy_assigned, 0);
+  }
+  template <class T>
+  static void moved(const T*) noexcept {
+    record<T>(_event_moved, 0);
+  }
+  template <class T>
+  static void destroyed(const T*) noexcept {
+    record<T>(_event_destroyed, -1);
+  }
+
+  // The counts of every owned type used so far.
+  static std::vector<type_statistics> statistics() {
+    return _instrumentation_registry::statistics();
+  }
+
+  // The counts of owned type T.
+  template <class T>
+  static type_statistics statistics_of() {
+    if (_instrumented_type* type = _instrumented_type_of<T>()) {
+      return _instrumentation_registry::statistics(*type);
+    }
+    return {};
+  }
+
+  // Prints the counts of every owned type used so far, the types which copy
+  // the most bytes first.
+  static void report(std::FILE* out = stderr) {
+    std::vector<type_statistics> types = statistics();
+    std::stable_sort(types.begin(), types.end(),
+                     [](const type_statistics& a, const type_statistics& b) {
+                       return a.bytes_copied() > b.bytes_copied();
+                     });
+    std::fprintf(out, "%10s %10s %10s %12s %10s %10s %10s %10s %14s  %s\n",
+                 "size", "live", "peak", "live bytes", "created", "copies",
+                 "copy assig", "moves", "bytes copied", "type");
+    for (const type_statistics& t : types) {
+      std::fprintf(out,
+                   "%10zu %10lld %10lld %12lld %10llu %10llu %10llu %10llu "
+                   "%14llu  %s\n",
+                   t.size, static_cast<long long>(t.live),
+                   static_cast<long long>(t.peak),
+                   static_cast<long long>(t.live_bytes()),
+                   static_cast<unsigned long long>(t.created),
+                   static_cast<unsigned long long>(t.copies),
+                   static_cast<unsigned long long>(t.copy_assignments),
+                   static_cast<unsigned long long>(t.moves),
+                   static_cast<unsigned long long>(t.bytes_copied()),
+                   t.type_name.c_str());
+    }
+    std::fflush(out);
+  }
+
+  // Arranges for report(out) to run when the program exits. Later calls
+  // change out.
+  static void report_at_exit(std::FILE* out = stderr) {
+    static std::atomic<std::FILE*> target{nullptr};
+    if (target.exchange(out) == nullptr) {
+      std::atexit([] { report(target.load()); });
+    }
+  }
+
+ private:
+  template <class T>
+  static void record(_instrumented_event event,
+                     std::int64_t live_delta) noexcept {
+    _instrumented_type* type = _instrumented_type_of<T>();
+    if (!type) return;
+    _instrumentation_shard* shard = _instrumentation_shard_of_thread();
+    _instrumentation_counters* c = shard ? shard->get(type->id) : nullptr;
+    if (!c) {
+      type->retired[event].fetch_add(1, std::memory_order_relaxed);
+      if (live_delta) type->publish(live_delta);
+      return;
+    }
+    auto& count = c->events[event];
+    count.store(count.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+    if (!live_delta) return;
+    const std::int64_t unpublished = c->unpublished_live += live_delta;
+    if (unpublished >= publish_threshold ||
+        unpublished <= -publish_threshold ||
+        (live_delta > 0 &&
+         type->live.load(std::memory_order_relaxed) + unpublished >
+             type->peak.load(std::memory_order_relaxed))) {
+      type->publish(std::exchange(c->unpublished_live, 0));
+    }
+  }
+};
+
+// A point in time, in nanoseconds, as used by lifetime_instrumentation.
+inline std::uint64_t _lifetime_now() noexcept {
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+inline constexpr std::size_t lifetime_buckets = 64;
+
+// Bucket b of a lifetime histogram counts lifetimes of [2^b, 2^(b+1))
+// nanoseconds, bucket 0 also those of 0.
+inline std::size_t _lifetime_bucket(std::uint64_t ns) noexcept {
+  std::size_t b = 0;
+  while (ns >>= 1) ++b;
+  return b;
+}
+
+enum class lifetime_class { short_lived, long_lived, mixed };
+
+// The lifetimes of the owned objects of one type, including the ages of the
+// objects which are still live.
+struct lifetime_statistics {
+  static constexpr std::uint64_t default_short_lived_ns = 1000 * 1000;
+  static constexpr std::uint64_t default_long_lived_ns = 1000 * 1000 * 1000;
+
+  std::string type_name;
+  std::size_t size = 0;
+  std::uint64_t ended = 0;
+  std::uint64_t live = 0;
+  std::uint64_t histogram[lifetime_buckets] = {};
+
+  std::uint64_t count() const noexcept { return ended + live; }
+
+  // An upper bound of the q-th quantile, for q in [0, 1], of the lifetimes.
+  std::uint64_t quantile_ns(double q) const noexcept {
+    const std::uint64_t n = count();
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b != lifetime_buckets; ++b) {
+      seen += histogram[b];
+      if (n && seen >= q * n) {
+        return b + 1 == lifetime_buckets ? ~std::uint64_t(0)
+                                         : (std::uint64_t(1) << (b + 1)) - 1;
+      }
+    }
+    return 0;
+  }
+
+  // Types whose objects nearly all (90%) live shorter than short_lived_ns are
+  // short-lived, and suit arena or monotonic allocation, which frees their
+  // memory all at once. Types whose objects mostly live longer than
+  // long_lived_ns are long-lived, and are better allocated individually, as
+  // an arena would hold the memory of the objects destroyed meanwhile.
+  lifetime_class classify(
+      std::uint64_t short_lived_ns = default_short_lived_ns,
+      std::uint64_t long_lived_ns = default_long_lived_ns) const noexcept {
+    if (quantile_ns(0.9) < short_lived_ns) return lifetime_class::short_lived;
+    if (quantile_ns(0.5) >= long_lived_ns) return lifetime_class::long_lived;
+    return lifetime_class::mixed;
+  }
+};
+
+// The objects created at one call site, with the call stack which created
+// them, innermost frame first.
+struct lifetime_site {
+  std::string type_name;
+  std::vector<void*> frames;
+  std::uint64_t created = 0;
+  std::uint64_t ended = 0;
+  std::uint64_t total_lifetime_ns = 0;
+
+  std::uint64_t mean_lifetime_ns() const noexcept {
+    return ended ? total_lifetime_ns / ended : 0;
+  }
+};
+
+struct _lifetime_type {
+  const _instrumented_type* type;
+  std::atomic<std::uint64_t> histogram[lifetime_buckets] = {};
+  std::atomic<std::uint64_t> ended{0};
+};
+
+struct _lifetime_site {
+  const _lifetime_type* type;
+  std::vector<void*> frames;
+  std::atomic<std::uint64_t> created{0};
+  std::atomic<std::uint64_t> ended{0};
+  std::atomic<std::uint64_t> total_lifetime_ns{0};
+};
+
+struct _lifetime_record {
+  std::uint64_t created_ns;
+  _lifetime_type* type;
+  _lifetime_site* site;
+};
+
+// The live objects, in shards by address, and the types and call sites
+// seen so far.
+class _lifetime_registry {
+ public:
+  static constexpr std::size_t shard_count = 64;
+  static constexpr int max_frames = 16;
+
+  static _lifetime_type* add_type(const _instrumented_type* type) noexcept {
+    _lifetime_registry& r = instance();
+    try {
+      std::lock_guard<std::mutex> lock(r.types_mutex_);
+      r.types_.push_back(std::make_unique<_lifetime_type>());
+      r.types_.back()->type = type;
+      return r.types_.back().get();
+    } catch (...) {
+      return nullptr;
+    }
+  }
+
+  static void begin(const void* p, _lifetime_type* type) noexcept {
+    _lifetime_registry& r = instance();
+    _lifetime_site* site =
+        r.record_call_sites.load(std::memory_order_relaxed) ? r.site(type)
+                                                            : nullptr;
+    shard& s = r.shard_of(p);
+    try {
+      std::lock_guard<std::mutex> lock(s.mutex);
+      s.live[p] = {_lifetime_now(), type, site};
+    } catch (...) {
+      // The object goes unrecorded.
+    }
+  }
+
+  static void end(const void* p) noexcept {
+    const std::uint64_t now = _lifetime_now();
+    _lifetime_registry& r = instance();
+    shard& s = r.shard_of(p);
+    _lifetime_record record;
+    {
+      std::lock_guard<std::mutex> lock(s.mutex);
+      auto it = s.live.find(p);
+      if (it == s.live.end()) return;
+      record = it->second;
+      s.live.erase(it);
+    }
+    const std::uint64_t lifetime = now - record.created_ns;
+    record.type->histogram[_lifetime_bucket(lifetime)].fetch_add(
+        1, std::memory_order_relaxed);
+    record.type->ended.fetch_add(1, std::memory_order_relaxed);
+    if (record.site) {
+      record.site->ended.fetch_add(1, std::memory_order_relaxed);
+      record.site->total_lifetime_ns.fetch_add(lifetime,
+                                               std::memory_order_relaxed);
+    }
+  }
+
+  static std::vector<lifetime_statistics> statistics() {
+    _lifetime_registry& r = instance();
+    std::vector<lifetime_statistics> result;
+    std::lock_guard<std::mutex> lock(r.types_mutex_);
+    result.reserve(r.types_.size());
+    for (const auto& t : r.types_) {
+      lifetime_statistics s;
+      s.type_name = t->type->name;
+      s.size = t->type->size;
+      s.ended = t->ended.load(std::memory_order_relaxed);
+      for (std::size_t b = 0; b != lifetime_buckets; ++b) {
+        s.histogram[b] = t->histogram[b].load(std::memory_order_relaxed);
+      }
+      result.push_back(std::move(s));
+    }
+    // Objects still live count with their ages.
+    const std::uint64_t now = _lifetime_now();
+    for (shard& s : r.shards_) {
+      std::lock_guard<std::mutex> shard_lock(s.mutex);
+      for (const auto& entry : s.live) {
+        const _lifetime_record& record = entry.second;
+        const std::size_t i = index_of(r, record.type);
+        ++result[i].live;
+        ++result[i].histogram[_lifetime_bucket(now - record.created_ns)];
+      }
+    }
+    return result;
+  }
+
+  static std::vector<lifetime_site> sites() {
+    _lifetime_registry& r = instance();
+    std::lock_guard<std::mutex> lock(r.sites_mutex_);
+    std::vector<lifetime_site> result;
+    result.reserve(r.sites_.size());
+    for (const auto& entry : r.sites_) {
+      const _lifetime_site& site = *entry.second;
+      lifetime_site s;
+      s.type_name = site.type->type->name;
+      s.frames = site.frames;
+      s.created = site.created.load(std::memory_order_relaxed);
+      s.ended = site.ended.load(std::memory_order_relaxed);
+      s.total_lifetime_ns =
+          site.total_lifetime_ns.load(std::memory_order_relaxed);
+      result.push_back(std::move(s));
+    }
+    return result;
+  }
+
+  static void set_record_call_sites(bool on) noexcept {
+    instance().record_call_sites.store(on, std::memory_order_relaxed);
+  }
+
+ private:
+  struct shard {
+    std::mutex mutex;
+    std::unordered_map<const void*, _lifetime_record> live;
+  };
+
+  // Intentionally leaked, so that objects destroyed during static
+  // destruction can still be recorded.
+  static _lifetime_registry& instance() {
+    static _lifetime_registry* registry = new _lifetime_registry;
+    return *registry;
+  }
+
+  shard& shard_of(const void* p) noexcept {
+    const auto address = reinterpret_cast<std::uintptr_t>(p);
+    return shards_[(address >> 4) * 0x9e3779b97f4a7c15ull >> 58];
+  }
+
+  // Called with types_mutex_ held.
+  static std::size_t index_of(const _lifetime_registry& r,
+                              const _lifetime_type* type) noexcept {
+    for (std::size_t i = 0; i != r.types_.size(); ++i) {
+      if (r.types_[i].get() == type) return i;
+    }
+    return 0;
+  }
+
+  // Returns the call site of the object being created, or nullptr.
+  _lifetime_site* site(const _lifetime_type* type) noexcept {
+#ifdef ISOCPP_P1950_HAS_EXECINFO
+    void* frames[max_frames];
+    const int n = ::backtrace(frames, max_frames);
+    std::uint64_t key = reinterpret_cast<std::uintptr_t>(type);
+    for (int i = 0; i != n; ++i) {
+      key = (key ^ reinterpret_cast<std::uintptr_t>(frames[i])) *
+            1099511628211ull;
+    }
+    try {
+      std::lock_guard<std::mutex> lock(sites_mutex_);
+      auto& site = sites_[key];
+      if (!site) {
+        site = std::make_unique<_lifetime_site>();
+        site->type = type;
+        site->frames.assign(frames, frames + n);
+      }
+      site->created.fetch_add(1, std::memory_order_relaxed);
+      return site.get();
+    } catch (...) {
+      return nullptr;
+    }
+#else
+    (void)type;
+    return nullptr;
+#endif
+  }
+
+  std::atomic<bool> record_call_sites{false};
+  shard shards_[shard_count];
+  std::mutex types_mutex_;
+  std::vector<std::unique_ptr<_lifetime_type>> types_;
+  std::mutex sites_mutex_;
+  std::unordered_map<std::uint64_t, std::unique_ptr<_lifetime_site>> sites_;
+};
+
+template <class T>
+_lifetime_type* _lifetime_type_of() noexcept {
+  static _lifetime_type* const type = [] {
+    const _instrumented_type* t = _instrumented_type_of<T>();
+    return t ? _lifetime_registry::add_type(t) : nullptr;
+  }();
+  return type;
+}
+
+inline std::string _format_duration(std::uint64_t ns) {
+  static constexpr const char* units[] = {"ns", "us", "ms", "s"};
+  double value = static_cast<double>(ns);
+  std::size_t unit = 0;
+  while (value >= 1000 && unit + 1 != std::size(units)) {
+    value /= 1000;
+    ++unit;
+  }
+  char text[32];
+  std::snprintf(text, sizeof(text), "%.3g%s", value, units[unit]);
+  return text;
+}
+
+// An instrumentation policy for indirect_value which measures how long owned
+// objects live, from their creation in place or by copying to their
+// destruction by reset, and builds a histogram of the lifetimes of each
+// owned type. The report suggests the types whose objects are short-lived
+// enough for arena or monotonic allocation, and those which are long-lived.
+//
+// Select it by compiling with
+//   -DISOCPP_P1950_INSTRUMENTATION=isocpp_p1950::lifetime_instrumentation
+// After record_call_sites(true), the call stack creating each object is
+// recorded too, and the report lists the call sites of each type; frames are
+// named when the program exports its symbols (-rdynamic), and otherwise
+// given as addresses to resolve with addr2line.
+//
+// Every creation and destruction takes a lock, one of shard_count chosen by
+// the address of the object, and recording call sites unwinds the stack, so
+// this policy is meant for profiling runs rather than production.
+class lifetime_instrumentation {
+ public:
+  template <class T>
+  static void created(const T* p) noexcept {
+    begin<T>(p);
+  }
+  template <class T>
+  static void copied(const T* p) noexcept {
+    begin<T>(p);
+  }
+  template <class T>
+  static void copy_assigned(const T*) noexcept {}
+  template <class T>
+  static void moved(const T*) noexcept {}
+  template <class T>
+  static void destroyed(const T* p) noexcept {
+    _lifetime_registry::end(p);
+  }
+
+  static void record_call_sites(bool on) noexcept {
+    _lifetime_registry::set_record_call_sites(on);
+  }
+
+  static std::vector<lifetime_statistics> statistics() {
+    return _lifetime_registry::statistics();
+  }
+
+  // The call sites recorded so far, the sites which created the most objects
+  // first.
+  static std::vector<lifetime_site> sites() {
+    std::vector<lifetime_site> result = _lifetime_registry::sites();
+    std::stable_sort(result.begin(), result.end(),
+                     [](const lifetime_site& a, const lifetime_site& b) {
+                       return a.created > b.created;
+                     });
+    return result;
+  }
+
+  // Prints the lifetime histogram, classification and call sites of each
+  // owned type, the types with the most objects first.
+  static void report(std::FILE* out = stderr,
+                     std::size_t sites_per_type = 5) {
+    std::vector<lifetime_statistics> types = statistics();
+    std::stable_sort(types.begin(), types.end(),
+                     [](const lifetime_statistics& a,
+                        const lifetime_statistics& b) {
+                       return a.count() > b.count();
+                     });
+    const std::vector<lifetime_site> all_sites = sites();
+    for (const lifetime_statistics& t : types) {
+      if (!t.count()) continue;
+      std::fprintf(out,
+                   "%s (%zu bytes): %llu ended, %llu live; lifetime median "
+                   "< %s, 90%% < %s: %s\n",
+                   t.type_name.c_str(), t.size,
+                   static_cast<unsigned long long>(t.ended),
+                   static_cast<unsigned long long>(t.live),
+                   _format_duration(t.quantile_ns(0.5) + 1).c_str(),
+                   _format_duration(t.quantile_ns(0.9) + 1).c_str(),
+                   describe(t.classify()));
+      for (std::size_t b = 0; b != lifetime_buckets; ++b) {
+        if (!t.histogram[b]) continue;
+        std::fprintf(out, "  %10s - %-10s %12llu\n",
+                     _format_duration(b ? std::uint64_t(1) << b : 0).c_str(),
+                     _format_duration(std::uint64_t(1) << (b + 1)).c_str(),
+                     static_cast<unsigned long long>(t.histogram[b]));
+      }
+      std::size_t printed = 0;
+      for (const lifetime_site& s : all_sites) {
+        if (s.type_name != t.type_name || printed++ == sites_per_type) {
+          continue;
+        }
+        print_site(out, s);
+      }
+    }
+    std::fflush(out);
+  }
+
+  // Arranges for report(out) to run when the program exits. Later calls
+  // change out.
+  static void report_at_exit(std::FILE* out = stderr) {
+    static std::atomic<std::FILE*> target{nullptr};
+    if (target.exchange(out) == nullptr) {
+      std::atexit([] { report(target.load()); });
+    }
+  }
+
+ private:
+  template <class T>
+  static void begin(const T* p) noexcept {
+    if (_lifetime_type* type = _lifetime_type_of<T>()) {
+      _lifetime_registry::begin(p, type);
+    }
+  }
+
+  static const char* describe(lifetime_class c) noexcept {
+    switch (c) {
+      case lifetime_class::short_lived:
+        return "short-lived, consider arena or monotonic allocation";
+      case lifetime_class::long_lived:
+        return "long-lived, keep individual allocation";
+      case lifetime_class::mixed:
+        break;
+    }
+    return "mixed lifetimes";
+  }
+
+  static void print_site(std::FILE* out, const lifetime_site& s) {
+    std::fprintf(out, "  %llu created here, %llu ended, mean lifetime %s:\n",
+                 static_cast<unsigned long long>(s.created),
+                 static_cast<unsigned long long>(s.ended),
+                 _format_duration(s.mean_lifetime_ns()).c_str());
+#ifdef ISOCPP_P1950_HAS_EXECINFO
+    char** names =
+        ::backtrace_symbols(s.frames.data(), static_cast<int>(s.frames.size()));
+    bool in_caller = false;
+    for (std::size_t i = 0; i != s.frames.size(); ++i) {
+      // Frames of indirect_value and this profiler come first.
+      in_caller = in_caller || !names ||
+                  !std::strstr(names[i], "isocpp_p1950");
+      if (in_caller) std::fprintf(out, "    %s\n", names ? names[i] : "?");
+    }
+    std::free(names);
+#endif
+  }
+};
+
+}  // namespace isocpp_p1950
+
+#endif  // ISOCPP_P1950_INDIRECT_VALUE_INSTRUMENTATION_H
@@ -0,0 +1,249 @@
+#ifndef ISOCPP_P1950_INDIRECT_VALUE_POOL_H
+#define ISOCPP_P1950_INDIRECT_VALUE_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "indirect_value.h"
+
+namespace isocpp_p1950 {
+
+// Objects of up to _pool_max_size bytes are allocated from thread-local
+// free lists, one per size class. Size classes are multiples of
+// _pool_granularity, so every block is suitably aligned for any type which
+// is not over-aligned.
+inline constexpr std::size_t _pool_granularity = alignof(std::max_align_t);
+inline constexpr std::size_t _pool_size_classes = 16;
+inline constexpr std::size_t _pool_max_size =
+    _pool_granularity * _pool_size_classes;
+
+// Blocks are carved from slabs which are aligned to their size, so that the
+// slab header of any block is found by masking its address.
+inline constexpr std::size_t _pool_slab_size = 64 * 1024;
+
+class _pool;
+
+struct _pool_block {
+  _pool_block* next;
+};
+
+struct alignas(std::max_align_t) _pool_slab {
+  _pool* owner;
+  std::size_t size_class;
+};
+
+inline _pool_slab* _pool_slab_of(void* p) noexcept {
+  const auto address = reinterpret_cast<std::uintptr_t>(p);
+  return reinterpret_cast<_pool_slab*>(address & ~(_pool_slab_size - 1));
+}
+
+// The pool of one thread. Only its owning thread allocates from it and
+// pushes to its free lists. Other threads return blocks through a lock-free
+// remote-free stack, which the owner drains when a free list runs empty.
+//
+// Pools are never destroyed: when a thread exits its pool is handed to the
+// next thread which needs one, together with its free lists, its slabs and
+// any blocks freed remotely in the meantime.
+class _pool {
+ public:
+  void* allocate(std::size_t size_class) {
+    if (!free_[size_class]) drain_remote();
+    if (_pool_block* b = free_[size_class]) {
+      free_[size_class] = b->next;
+      return b;
+    }
+    const std::size_t size = (size_class + 1) * _pool_granularity;
+    if (bump_[size_class] == end_[size_class]) {
+      void* memory =
+          ::operator new(_pool_slab_size, std::align_val_t(_pool_slab_size));
+      ::new (memory) _pool_slab{this, size_class};
+      char* first = static_cast<char*>(memory) + sizeof(_pool_slab);
+      bump_[size_class] = first;
+      end_[size_class] =
+          first + (_pool_slab_size - sizeof(_pool_slab)) / size * size;
+    }
+    void* block = bump_[size_class];
+    bump_[size_class] += size;
+    return block;
+  }
+
+  void deallocate_local(void* p, std::size_t size_class) noexcept {
+    auto* b = static_cast<_pool_block*>(p);
+    b->next = free_[size_class];
+    free_[size_class] = b;
+  }
+
+  void deallocate_remote(void* p) noexcept {
+    auto* b = static_cast<_pool_block*>(p);
+    b->next = remote_.load(std::memory_order_relaxed);
+    while (!remote_.compare_exchange_weak(b->next, b,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed)) {
+    }
+  }
+
+ private:
+  void drain_remote() noexcept {
+    // Taking the whole stack at once avoids the ABA problem of popping
+    // single blocks.
+    _pool_block* b = remote_.exchange(nullptr, std::memory_order_acquire);
+    while (b) {
+      _pool_block* next = b->next;
+      deallocate_local(b, _pool_slab_of(b)->size_class);
+      b = next;
+    }
+  }
+
+  _pool_block* free_[_pool_size_classes] = {};
+  char* bump_[_pool_size_classes] = {};
+  char* end_[_pool_size_classes] = {};
+  std::atomic<_pool_block*> remote_{nullptr};
+};
+
+// Pools whose threads have exited, waiting for a new owner.
+class _pool_registry {
+ public:
+  static _pool* acquire() {
+    _pool_registry& r = instance();
+    std::lock_guard<std::mutex> lock(r.mutex_);
+    if (r.orphans_.empty()) return new _pool;
+    _pool* p = r.orphans_.back();
+    r.orphans_.pop_back();
+    return p;
+  }
+
+  static void release(_pool* p) {
+    _pool_registry& r = instance();
+    std::lock_guard<std::mutex> lock(r.mutex_);
+    r.orphans_.push_back(p);
+  }
+
+ private:
+  // Intentionally leaked, so that threads which outlive static destruction
+  // can still hand back their pools.
+  static _pool_registry& instance() {
+    static _pool_registry* registry = new _pool_registry;
+    return *registry;
+  }
+
+  std::mutex mutex_;
+  std::vector<_pool*> orphans_;
+};
+
+inline thread_local _pool* _pool_current = nullptr;
+inline thread_local bool _pool_thread_exited = false;
+
+struct _pool_thread_guard {
+  ~_pool_thread_guard() {
+    if (_pool_current) _pool_registry::release(_pool_current);
+    _pool_current = nullptr;
+    _pool_thread_exited = true;
+  }
+};
+
+inline thread_local _pool_thread_guard _pool_guard;
+
+inline void* _pool_allocate(std::size_t size_class) {
+  if (_pool* p = _pool_current) return p->allocate(size_class);
+  _pool* p = _pool_registry::acquire();
+  if (_pool_thread_exited) {
+    // Allocations made while thread-local objects are destroyed borrow a
+    // pool for the duration of the call only.
+    struct release_on_exit {
+      _pool* p;
+      ~release_on_exit() { _pool_registry::release(p); }
+    } release{p};
+    return p->allocate(size_class);
+  }
+  (void)&_pool_guard;  // Registers the guard, which returns the pool.
+  _pool_current = p;
+  return p->allocate(size_class);
+}
+
+inline void _pool_deallocate(void* p) noexcept {
+  _pool_slab* slab = _pool_slab_of(p);
+  if (slab->owner == _pool_current) {
+    slab->owner->deallocate_local(p, slab->size_class);
+  } else {
+    slab->owner->deallocate_remote(p);
+  }
+}
+
+// An allocator backed by thread-local, size-class segregated free lists.
+//
+// Allocation and deallocation on the allocating thread take no locks and
+// use no atomic operations. A block freed by another thread is pushed onto
+// a lock-free queue of its owning pool and reused by that pool later.
+// Requests which are too large or over-aligned go to std::allocator.
+//
+// Memory of the pools is retained for reuse and not returned to the system.
+template <class T>
+class pool_allocator {
+ public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  pool_allocator() = default;
+  template <class U>
+  pool_allocator(const pool_allocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    if (!uses_pool(n)) return std::allocator<T>().allocate(n);
+    return static_cast<T*>(_pool_allocate(size_class(n)));
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept {
+    if (!uses_pool(n)) return std::allocator<T>().deallocate(p, n);
+    _pool_deallocate(p);
+  }
+
+  template <class U>
+  friend bool operator==(const pool_allocator&,
+                         const pool_allocator<U>&) noexcept {
+    return true;
+  }
+
+  template <class U>
+  friend bool operator!=(const pool_allocator&,
+                         const pool_allocator<U>&) noexcept {
+    return false;
+  }
+
+ private:
+  static constexpr bool uses_pool(std::size_t n) noexcept {
+    return alignof(T) <= _pool_granularity &&
+           n <= _pool_max_size / sizeof(T);
+  }
+
+  static constexpr std::size_t size_class(std::size_t n) noexcept {
+    const std::size_t size = n == 0 ? 1 : n * sizeof(T);
+    return (size - 1) / _pool_granularity;
+  }
+};
+
+template <class T>
+struct is_trivially_relocatable<pool_allocator<T>> : std::true_type {};
+
+// A copier and deleter which allocate owned objects from the thread-local
+// pools of pool_allocator. Both are empty, so an indirect_value using them
+// is the size of a pointer; its in-place constructor allocates from the
+// pools as well.
+template <class T>
+using pooled_copy = allocator_copy<T, pool_allocator<T>>;
+
+template <class T>
+using pooled_delete = allocator_delete<T, pool_allocator<T>>;
+
+template <class T>
+using pooled_indirect_value =
+    indirect_value<T, pooled_copy<T>, pooled_delete<T>>;
+
+}  // namespace isocpp_p1950
+
+#endif  // ISOCPP_P1950_INDIRECT_VALUE_POOL_H
@@ -0,0 +1,177 @@
+#ifndef ISOCPP_P1950_INDIRECT_VALUE_PREFETCH_H
+#define ISOCPP_P1950_INDIRECT_VALUE_PREFETCH_H
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#if defined(_MSC_VER) && !defined(__clang__) && \
+    (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h>
+#endif
+
+#include "indirect_value.h"
+
+namespace isocpp_p1950 {
+
+// Hints that the cache line at p is about to be read, or written when
+// ForWrite. p need not be valid: prefetching never faults.
+template <bool ForWrite>
+inline void _prefetch_address(const void* p) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(p, ForWrite ? 1 : 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+  _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+  (void)p;
+#endif
+}
+
+// Starts loading the owned object of v into the cache, so that a later
+// access does not wait for memory. Does nothing when v is empty.
+template <class T, class C, class D>
+void prefetch(const indirect_value<T, C, D>& v) noexcept {
+  if (v) _prefetch_address<false>(std::addressof(*v));
+}
+
+// As prefetch, for an owned object which is about to be modified.
+template <class T, class C, class D>
+void prefetch_for_write(indirect_value<T, C, D>& v) noexcept {
+  if (v) _prefetch_address<true>(std::addressof(*v));
+}
+
+// The number of elements ahead of the current one whose owned objects
+// views::indirect_prefetch loads by default. It covers a memory latency of
+// several hundred cycles for loops which do little work per element.
+inline constexpr std::size_t default_prefetch_distance = 8;
+
+// An iterator over the owned objects of a range of indirect_values, which
+// keeps the owned objects of the distance elements from the current one
+// prefetched. Elements are prefetched with prefetch, found by
+// argument-dependent lookup, so other types can take part by providing it.
+template <class Iterator>
+class indirect_prefetch_iterator {
+ public:
+  using iterator_category = std::forward_iterator_tag;
+  using reference = decltype(**std::declval<Iterator>());
+  using value_type = std::remove_cv_t<std::remove_reference_t<reference>>;
+  using difference_type =
+      typename std::iterator_traits<Iterator>::difference_type;
+  using pointer = std::add_pointer_t<reference>;
+
+  indirect_prefetch_iterator() = default;
+
+  // Prefetches the owned objects of up to distance elements from current.
+  indirect_prefetch_iterator(Iterator current, Iterator end,
+                             std::size_t distance)
+      : current_(current), ahead_(current), end_(end) {
+    for (std::size_t i = 0; i != distance && ahead_ != end_; ++i, ++ahead_) {
+      prefetch(*ahead_);
+    }
+  }
+
+  reference operator*() const { return **current_; }
+  pointer operator->() const { return std::addressof(**current_); }
+
+  indirect_prefetch_iterator& operator++() {
+    ++current_;
+    if (ahead_ != end_) {
+      prefetch(*ahead_);
+      ++ahead_;
+    }
+    return *this;
+  }
+
+  indirect_prefetch_iterator operator++(int) {
+    auto old = *this;
+    ++*this;
+    return old;
+  }
+
+  friend bool operator==(const indirect_prefetch_iterator& a,
+                         const indirect_prefetch_iterator& b) {
+    return a.current_ == b.current_;
+  }
+
+  friend bool operator!=(const indirect_prefetch_iterator& a,
+                         const indirect_prefetch_iterator& b) {
+    return !(a == b);
+  }
+
+ private:
+  Iterator current_{};
+  Iterator ahead_{};
+  Iterator end_{};
+};
+
+// The owned objects of a range of indirect_values, whose iteration
+// prefetches the owned objects of the next distance elements, so that a
+// linear scan overlaps the cache misses of several elements instead of
+// waiting for each in turn. Every element must have a value, as the
+// elements are dereferenced.
+template <class Range>
+class indirect_prefetch_view {
+  using base_iterator = decltype(std::begin(std::declval<Range&>()));
+
+ public:
+  using iterator = indirect_prefetch_iterator<base_iterator>;
+
+  indirect_prefetch_view(Range& range, std::size_t distance) noexcept
+      : range_(&range), distance_(distance) {}
+
+  iterator begin() const {
+    return iterator(std::begin(*range_), std::end(*range_), distance_);
+  }
+
+  iterator end() const {
+    return iterator(std::end(*range_), std::end(*range_), 0);
+  }
+
+ private:
+  Range* range_;
+  std::size_t distance_;
+};
+
+namespace views {
+
+struct _indirect_prefetch_closure {
+  std::size_t distance;
+
+  template <class Range>
+  friend indirect_prefetch_view<Range> operator|(
+      Range& range, _indirect_prefetch_closure c) noexcept {
+    return indirect_prefetch_view<Range>(range, c.distance);
+  }
+};
+
+struct _indirect_prefetch_fn {
+  _indirect_prefetch_closure operator()(
+      std::size_t distance = default_prefetch_distance) const noexcept {
+    return {distance};
+  }
+
+  template <class Range, class = decltype(std::begin(std::declval<Range&>()))>
+  indirect_prefetch_view<Range> operator()(
+      Range& range,
+      std::size_t distance = default_prefetch_distance) const noexcept {
+    return indirect_prefetch_view<Range>(range, distance);
+  }
+};
+
+// A view of the owned objects of a range of indirect_values, which
+// prefetches k elements ahead:
+//
+//   for (const auto& cold : elements | views::indirect_prefetch(8)) {
+//     ...
+//   }
+//
+// or views::indirect_prefetch(elements, 8).
+inline constexpr _indirect_prefetch_fn indirect_prefetch{};
+
+}  // namespace views
+
+}  // namespace isocpp_p1950
+
+#endif  // ISOCPP_P1950_INDIRECT_VALUE_PREFETCH_H
@@ -0,0 +1,224 @@
+#ifndef ISOCPP_P1950_INDIRECT_VALUE_SLOT_MAP_H
+#define ISOCPP_P1950_INDIRECT_VALUE_SLOT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+#include "indirect_value.h"
+
+namespace isocpp_p1950 {
+
+inline int _count_trailing_zeros(std::uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(x);
+#else
+  int n = 0;
+  while (!(x & 1)) {
+    x >>= 1;
+    ++n;
+  }
+  return n;
+#endif
+}
+
+constexpr std::size_t _bit_ceil(std::size_t n) noexcept {
+  std::size_t p = 1;
+  while (p < n) p *= 2;
+  return p;
+}
+
+// The objects of type T owned by slot_map_indirect_values, which all live
+// in contiguous arrays of slots, one object per slot.
+//
+// The arrays are chunks of 64 KiB, or of a single slot for larger objects,
+// which are never moved, so objects keep their addresses and indirect_values
+// can point to them. Freed slots are reused, most recently freed first,
+// before chunks are extended, so the objects stay densely packed. A bitmap
+// per chunk marks the slots in use, and for_each visits their objects chunk
+// by chunk in slot order, reading memory sequentially rather than following
+// one pointer per object.
+//
+// Chunks are aligned to their size, so that the chunk of an object is found
+// by masking its address. Allocating and freeing slots, and for_each, take
+// the lock of the slot map of T. Chunks are retained for reuse and not
+// returned to the system.
+template <class T>
+class slot_map {
+  struct slot {
+    alignas(T) alignas(void*) unsigned char
+        bytes[sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T)];
+  };
+
+  // As many slots as fit into 64 KiB together with their bit in the bitmap
+  // and the rest of the chunk header, or one slot for a larger T.
+  static constexpr std::size_t chunk_budget = 64 * 1024;
+  static constexpr std::size_t chunk_overhead =
+      sizeof(void*) + sizeof(std::uint64_t) + alignof(slot);
+  static constexpr std::size_t fitting_slots =
+      (chunk_budget - chunk_overhead) * 8 / (8 * sizeof(slot) + 1);
+  static constexpr std::size_t slots_per_chunk =
+      fitting_slots > 0 ? fitting_slots : 1;
+  static constexpr std::size_t bitmap_words = (slots_per_chunk + 63) / 64;
+
+  struct chunk {
+    chunk* next = nullptr;
+    std::uint64_t in_use[bitmap_words] = {};
+    slot slots[slots_per_chunk];  // Left uninitialized.
+  };
+
+  static_assert(sizeof(chunk) <= chunk_budget || slots_per_chunk == 1);
+
+  static constexpr std::size_t chunk_size = _bit_ceil(sizeof(chunk));
+
+ public:
+  // Returns uninitialized storage for a T, from a slot of the map.
+  static T* allocate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slot* s = free_;
+    if (s) {
+      free_ = *std::launder(reinterpret_cast<slot**>(s->bytes));
+    } else {
+      if (!last_ || used_ == slots_per_chunk) add_chunk();
+      s = &last_->slots[used_++];
+    }
+    mark(s, true);
+    ++size_;
+    return reinterpret_cast<T*>(s->bytes);
+  }
+
+  // Returns the storage of p, whose object has been destroyed, to the map.
+  static void deallocate(T* p) noexcept {
+    auto* s = reinterpret_cast<slot*>(p);
+    std::lock_guard<std::mutex> lock(mutex_);
+    mark(s, false);
+    ::new (static_cast<void*>(s->bytes)) slot*(free_);
+    free_ = s;
+    --size_;
+  }
+
+  // Calls f with each object in the map. f must not create or destroy
+  // objects of the map, and objects must not be created or destroyed by
+  // other threads meanwhile.
+  template <class F>
+  static void for_each(F f) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (chunk* c = first_; c; c = c->next) {
+      for (std::size_t w = 0; w != bitmap_words; ++w) {
+        for (std::uint64_t bits = c->in_use[w]; bits; bits &= bits - 1) {
+          slot& s = c->slots[w * 64 + _count_trailing_zeros(bits)];
+          f(*std::launder(reinterpret_cast<T*>(s.bytes)));
+        }
+      }
+    }
+  }
+
+  // The number of objects in the map.
+  static std::size_t size() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+  }
+
+  // Whether p points into a slot of the map.
+  static bool owns(const void* p) noexcept {
+    const auto address = reinterpret_cast<std::uintptr_t>(p);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const chunk* c = first_; c; c = c->next) {
+      const auto first = reinterpret_cast<std::uintptr_t>(c->slots);
+      if (address >= first && address < first + sizeof(c->slots)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  static void add_chunk() {
+    void* memory = ::operator new(chunk_size, std::align_val_t(chunk_size));
+    chunk* c = ::new (memory) chunk;
+    (last_ ? last_->next : first_) = c;
+    last_ = c;
+    used_ = 0;
+  }
+
+  static void mark(slot* s, bool in_use) noexcept {
+    const auto address = reinterpret_cast<std::uintptr_t>(s);
+    auto* c = reinterpret_cast<chunk*>(address & ~(chunk_size - 1));
+    const std::size_t i = std::size_t(s - c->slots);
+    const std::uint64_t bit = std::uint64_t(1) << (i % 64);
+    if (in_use) {
+      c->in_use[i / 64] |= bit;
+    } else {
+      c->in_use[i / 64] &= ~bit;
+    }
+  }
+
+  // Constant-initialized, so that objects may be created and destroyed
+  // during static initialization and destruction.
+  static inline std::mutex mutex_;
+  static inline chunk* first_ = nullptr;
+  static inline chunk* last_ = nullptr;
+  static inline std::size_t used_ = 0;  // The slots used in last_.
+  static inline slot* free_ = nullptr;  // A list linked through slots.
+  static inline std::size_t size_ = 0;
+};
+
+// An allocator which allocates single objects from the slot map of their
+// type. Other requests go to std::allocator.
+template <class T>
+class slot_map_allocator {
+ public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  slot_map_allocator() = default;
+  template <class U>
+  slot_map_allocator(const slot_map_allocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    if (n != 1) return std::allocator<T>().allocate(n);
+    return slot_map<T>::allocate();
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept {
+    if (n != 1) return std::allocator<T>().deallocate(p, n);
+    slot_map<T>::deallocate(p);
+  }
+
+  template <class U>
+  friend bool operator==(const slot_map_allocator&,
+                         const slot_map_allocator<U>&) noexcept {
+    return true;
+  }
+
+  template <class U>
+  friend bool operator!=(const slot_map_allocator&,
+                         const slot_map_allocator<U>&) noexcept {
+    return false;
+  }
+};
+
+template <class T>
+struct is_trivially_relocatable<slot_map_allocator<T>> : std::true_type {};
+
+// A copier and deleter which allocate owned objects from the slot map of
+// T. Both are empty, so an indirect_value using them is the size of a
+// pointer; its in-place constructor allocates from the slot map as well, so
+// slot_map<T>::for_each visits the owned objects of all
+// slot_map_indirect_value<T>s.
+template <class T>
+using slot_map_copy = allocator_copy<T, slot_map_allocator<T>>;
+
+template <class T>
+using slot_map_delete = allocator_delete<T, slot_map_allocator<T>>;
+
+template <class T>
+using slot_map_indirect_value =
+    indirect_value<T, slot_map_copy<T>, slot_map_delete<T>>;
+
+}  // namespace isocpp_p1950
+
+#endif  // ISOCPP_P1950_INDIRECT_VALUE_SLOT_MAP_H
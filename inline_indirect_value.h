@@ -0,0 +1,183 @@
+#ifndef ISOCPP_P1950_INLINE_INDIRECT_VALUE_H
+#define ISOCPP_P1950_INLINE_INDIRECT_VALUE_H
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "indirect_value.h"
+
+namespace isocpp_p1950 {
+
+// The default buffer size makes an inline_indirect_value fill one 64-byte
+// cache line on platforms with 8-byte pointers.
+inline constexpr std::size_t default_inline_indirect_value_size =
+    64 - sizeof(void*);
+
+// An indirect_value with a small buffer optimization.
+//
+// An owned object of type T is stored in a buffer of N bytes inside the
+// inline_indirect_value when it fits, and on the free store otherwise. T fits
+// when it is no larger than N, is not over-aligned and is nothrow move
+// constructible, so that moving an inline_indirect_value never throws.
+//
+// The owned object is always reached through a pointer, which points either
+// into the buffer or to the free store, so operator-> and operator* are as
+// cheap as for indirect_value. Where the owned object lives depends only on
+// T, so no other member function has to test it at run time either.
+//
+// That decision is only made in member functions which create, move or
+// destroy the owned object, so T may be incomplete where the
+// inline_indirect_value is declared, as for the pimpl idiom.
+template <class T, std::size_t N = default_inline_indirect_value_size>
+class inline_indirect_value {
+  alignas(std::max_align_t) unsigned char buffer_[N];
+  T* ptr_ = nullptr;
+
+ public:
+  using value_type = T;
+
+  // True when an owned object is stored in the buffer.
+  static constexpr bool is_stored_inline() noexcept {
+    return sizeof(T) <= N && alignof(T) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible_v<T>;
+  }
+
+  inline_indirect_value() noexcept {}
+
+  template <class... Ts>
+  explicit inline_indirect_value(std::in_place_t, Ts&&... ts) {
+    if constexpr (is_stored_inline()) {
+      ptr_ = ::new (static_cast<void*>(buffer_)) T(std::forward<Ts>(ts)...);
+    } else {
+      ptr_ = new T(std::forward<Ts>(ts)...);
+    }
+  }
+
+  inline_indirect_value(const inline_indirect_value& i) {
+    if (i.ptr_) {
+      if constexpr (is_stored_inline()) {
+        ptr_ = ::new (static_cast<void*>(buffer_)) T(*i.ptr_);
+      } else {
+        ptr_ = new T(*i.ptr_);
+      }
+    }
+  }
+
+  inline_indirect_value(inline_indirect_value&& i) noexcept {
+    move_from(i);
+  }
+
+  inline_indirect_value& operator=(const inline_indirect_value& i) {
+    if (this != &i) {
+      // Copy first, so that *this is unchanged when copying T throws.
+      inline_indirect_value temp(i);
+      reset();
+      move_from(temp);
+    }
+    return *this;
+  }
+
+  inline_indirect_value& operator=(inline_indirect_value&& i) noexcept {
+    if (this != &i) {
+      reset();
+      move_from(i);
+    }
+    return *this;
+  }
+
+  ~inline_indirect_value() { reset(); }
+
+  T* operator->() noexcept { return ptr_; }
+
+  const T* operator->() const noexcept { return ptr_; }
+
+  T& operator*() & noexcept { return *ptr_; }
+
+  const T& operator*() const& noexcept { return *ptr_; }
+
+  T&& operator*() && noexcept { return std::move(*ptr_); }
+
+  const T&& operator*() const&& noexcept { return std::move(*ptr_); }
+
+  T& value() & {
+    if (!ptr_) throw bad_indirect_value_access();
+    return *ptr_;
+  }
+
+  const T& value() const& {
+    if (!ptr_) throw bad_indirect_value_access();
+    return *ptr_;
+  }
+
+  T&& value() && {
+    if (!ptr_) throw bad_indirect_value_access();
+    return std::move(*ptr_);
+  }
+
+  const T&& value() const&& {
+    if (!ptr_) throw bad_indirect_value_access();
+    return std::move(*ptr_);
+  }
+
+  explicit constexpr operator bool() const noexcept { return ptr_ != nullptr; }
+
+  bool has_value() const noexcept { return ptr_ != nullptr; }
+
+  void swap(inline_indirect_value& rhs) noexcept {
+    if (this == &rhs) return;
+    inline_indirect_value temp(std::move(rhs));
+    rhs = std::move(*this);
+    *this = std::move(temp);
+  }
+
+  friend void swap(inline_indirect_value& lhs,
+                   inline_indirect_value& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+
+ private:
+  // Takes the owned object of i, leaving i empty. *this must be empty.
+  void move_from(inline_indirect_value& i) noexcept {
+    if constexpr (is_stored_inline()) {
+      if (i.ptr_) {
+        ptr_ = ::new (static_cast<void*>(buffer_)) T(std::move(*i.ptr_));
+        i.reset();
+      }
+    } else {
+      ptr_ = std::exchange(i.ptr_, nullptr);
+    }
+  }
+
+  void reset() noexcept {
+    if (ptr_) {
+      // As for indirect_value, set ptr_ to nullptr before destroying the
+      // owned object, in case its destructor accesses this object.
+      T* p = std::exchange(ptr_, nullptr);
+      if constexpr (is_stored_inline()) {
+        p->~T();
+      } else {
+        delete p;
+      }
+    }
+  }
+};
+
+// inline_indirect_values compare as indirect_values do, including with
+// them.
+template <class T, std::size_t N>
+inline constexpr bool _is_indirect_v<inline_indirect_value<T, N>> = true;
+
+}  // namespace isocpp_p1950
+
+namespace std {
+template <class T, std::size_t N>
+struct hash<::isocpp_p1950::inline_indirect_value<T, N>>
+    : ::isocpp_p1950::_conditionally_enabled_hash<
+          ::isocpp_p1950::inline_indirect_value<T, N>,
+          is_default_constructible_v<hash<T>>> {};
+}  // namespace std
+
+#endif  // ISOCPP_P1950_INLINE_INDIRECT_VALUE_H
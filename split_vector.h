@@ -0,0 +1,384 @@
+#ifndef ISOCPP_P1950_SPLIT_VECTOR_H
+#define ISOCPP_P1950_SPLIT_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace isocpp_p1950 {
+
+// The cold part of an element of a split_vector, reached like the owned
+// object of an indirect_value: through operator-> and operator*, with
+// constness propagated from the handle to the cold part.
+//
+// A cold_handle refers to the cold part of one element. Assigning to it
+// copies the cold part, as assigning an indirect_value copies the owned
+// object, rather than rebinding the handle.
+template <class T>
+class cold_handle {
+ public:
+  using value_type = T;
+
+  explicit cold_handle(T* p) noexcept : ptr_(p) {}
+  cold_handle(const cold_handle&) = default;
+
+  cold_handle& operator=(const cold_handle& other) {
+    *ptr_ = *other.ptr_;
+    return *this;
+  }
+
+  template <class U, class = std::enable_if_t<std::is_assignable_v<T&, U>>>
+  cold_handle& operator=(U&& u) {
+    *ptr_ = std::forward<U>(u);
+    return *this;
+  }
+
+  T* operator->() noexcept { return ptr_; }
+  const T* operator->() const noexcept { return ptr_; }
+
+  T& operator*() noexcept { return *ptr_; }
+  const T& operator*() const noexcept { return *ptr_; }
+
+ private:
+  T* ptr_;
+};
+
+// An element of a split_vector, as a value.
+template <class Hot, class Cold>
+struct split_value {
+  Hot hot;
+  Cold cold;
+};
+
+// A reference to an element of a split_vector, whose hot and cold parts are
+// stored apart. Constness propagates from the reference to both parts, and
+// assigning to it assigns both parts.
+template <class Hot, class Cold>
+class split_reference {
+ public:
+  split_reference(Hot* hot, Cold* cold) noexcept : hot_(hot), cold_(cold) {}
+  split_reference(const split_reference&) = default;
+
+  split_reference& operator=(const split_reference& other) {
+    *hot_ = *other.hot_;
+    cold_ = other.cold_;
+    return *this;
+  }
+
+  template <class H, class C>
+  split_reference& operator=(const split_reference<H, C>& other) {
+    *hot_ = other.hot();
+    cold_ = *other.cold();
+    return *this;
+  }
+
+  template <class H, class C>
+  split_reference& operator=(const split_value<H, C>& value) {
+    *hot_ = value.hot;
+    cold_ = value.cold;
+    return *this;
+  }
+
+  template <class H, class C>
+  split_reference& operator=(split_value<H, C>&& value) {
+    *hot_ = std::move(value.hot);
+    cold_ = std::move(value.cold);
+    return *this;
+  }
+
+  Hot& hot() noexcept { return *hot_; }
+  const Hot& hot() const noexcept { return *hot_; }
+
+  cold_handle<Cold>& cold() noexcept { return cold_; }
+  const cold_handle<Cold>& cold() const noexcept { return cold_; }
+
+  // A copy of the element.
+  operator split_value<std::remove_const_t<Hot>, std::remove_const_t<Cold>>()
+      const {
+    return {*hot_, *cold_};
+  }
+
+ private:
+  Hot* hot_;
+  cold_handle<Cold> cold_;
+};
+
+template <class Hot, class Cold, bool Const>
+class _split_iterator {
+  using hot_type = std::conditional_t<Const, const Hot, Hot>;
+  using cold_type = std::conditional_t<Const, const Cold, Cold>;
+
+ public:
+  // Like the iterators of vector<bool>, these iterators return a proxy
+  // reference.
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = split_value<Hot, Cold>;
+  using difference_type = std::ptrdiff_t;
+  using reference = split_reference<hot_type, cold_type>;
+
+  class pointer {
+   public:
+    reference* operator->() noexcept { return &r_; }
+
+   private:
+    friend class _split_iterator;
+    explicit pointer(reference r) noexcept : r_(r) {}
+    reference r_;
+  };
+
+  _split_iterator() = default;
+  _split_iterator(hot_type* hot, cold_type* cold) noexcept
+      : hot_(hot), cold_(cold) {}
+  template <bool C, class = std::enable_if_t<Const && !C>>
+  _split_iterator(const _split_iterator<Hot, Cold, C>& other) noexcept
+      : hot_(other.hot_), cold_(other.cold_) {}
+
+  reference operator*() const noexcept { return {hot_, cold_}; }
+  pointer operator->() const noexcept { return pointer(**this); }
+  reference operator[](difference_type n) const noexcept {
+    return {hot_ + n, cold_ + n};
+  }
+
+  _split_iterator& operator++() noexcept { return *this += 1; }
+  _split_iterator operator++(int) noexcept {
+    auto old = *this;
+    ++*this;
+    return old;
+  }
+  _split_iterator& operator--() noexcept { return *this -= 1; }
+  _split_iterator operator--(int) noexcept {
+    auto old = *this;
+    --*this;
+    return old;
+  }
+  _split_iterator& operator+=(difference_type n) noexcept {
+    hot_ += n;
+    cold_ += n;
+    return *this;
+  }
+  _split_iterator& operator-=(difference_type n) noexcept {
+    return *this += -n;
+  }
+
+  friend _split_iterator operator+(_split_iterator i,
+                                   difference_type n) noexcept {
+    return i += n;
+  }
+  friend _split_iterator operator+(difference_type n,
+                                   _split_iterator i) noexcept {
+    return i += n;
+  }
+  friend _split_iterator operator-(_split_iterator i,
+                                   difference_type n) noexcept {
+    return i -= n;
+  }
+  friend difference_type operator-(const _split_iterator& a,
+                                   const _split_iterator& b) noexcept {
+    return a.hot_ - b.hot_;
+  }
+
+  friend bool operator==(const _split_iterator& a,
+                         const _split_iterator& b) noexcept {
+    return a.hot_ == b.hot_;
+  }
+  friend bool operator!=(const _split_iterator& a,
+                         const _split_iterator& b) noexcept {
+    return a.hot_ != b.hot_;
+  }
+  friend bool operator<(const _split_iterator& a,
+                        const _split_iterator& b) noexcept {
+    return a.hot_ < b.hot_;
+  }
+  friend bool operator>(const _split_iterator& a,
+                        const _split_iterator& b) noexcept {
+    return b < a;
+  }
+  friend bool operator<=(const _split_iterator& a,
+                         const _split_iterator& b) noexcept {
+    return !(b < a);
+  }
+  friend bool operator>=(const _split_iterator& a,
+                         const _split_iterator& b) noexcept {
+    return !(a < b);
+  }
+
+ private:
+  friend class _split_iterator<Hot, Cold, true>;
+
+  hot_type* hot_ = nullptr;
+  cold_type* cold_ = nullptr;
+};
+
+// A contiguous range of one part of the elements of a split_vector.
+template <class T>
+class split_column {
+ public:
+  split_column(T* first, std::size_t size) noexcept
+      : first_(first), size_(size) {}
+
+  T* begin() const noexcept { return first_; }
+  T* end() const noexcept { return first_ + size_; }
+  T* data() const noexcept { return first_; }
+  std::size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  T& operator[](std::size_t i) const noexcept { return first_[i]; }
+
+ private:
+  T* first_;
+  std::size_t size_;
+};
+
+// A sequence of elements split into a frequently accessed hot part and an
+// infrequently accessed cold part, as in the hot-cold splitting example of
+// P1950, stored as two parallel contiguous arrays.
+//
+// Scans over the hot parts read only hot data, as with indirect_value<Cold>
+// members, but without an allocation and a pointer per element, and scans
+// over the cold parts read contiguous memory rather than one heap block per
+// element. The element i is reached with operator[], which returns a
+// reference whose hot() is the hot part and whose cold() is a cold_handle,
+// used like an indirect_value:
+//
+//   split_vector<SmallData, LargeData> elements;
+//   auto active = std::find_if(elements.begin(), elements.end(),
+//                              [](const auto& e) { return e.hot().active(); });
+//   if (active != elements.end()) use(*active->cold());
+//
+// hot() and cold() return the parts of all elements as contiguous ranges.
+// Copying a split_vector copies all elements, and constness propagates from
+// the split_vector to the parts of its elements.
+template <class Hot, class Cold>
+class split_vector {
+ public:
+  using value_type = split_value<Hot, Cold>;
+  using reference = split_reference<Hot, Cold>;
+  using const_reference = split_reference<const Hot, const Cold>;
+  using iterator = _split_iterator<Hot, Cold, false>;
+  using const_iterator = _split_iterator<Hot, Cold, true>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+
+  split_vector() = default;
+
+  explicit split_vector(size_type n) : hot_(n), cold_(n) {}
+
+  split_vector(size_type n, const Hot& hot, const Cold& cold)
+      : hot_(n, hot), cold_(n, cold) {}
+
+  size_type size() const noexcept { return hot_.size(); }
+  bool empty() const noexcept { return hot_.empty(); }
+  size_type capacity() const noexcept {
+    return std::min(hot_.capacity(), cold_.capacity());
+  }
+
+  void reserve(size_type n) {
+    hot_.reserve(n);
+    cold_.reserve(n);
+  }
+
+  // If resizing throws, the split_vector is unchanged.
+  void resize(size_type n) {
+    const size_type old_size = size();
+    hot_.resize(n);
+    try {
+      cold_.resize(n);
+    } catch (...) {
+      hot_.resize(old_size);
+      throw;
+    }
+  }
+
+  void clear() noexcept {
+    hot_.clear();
+    cold_.clear();
+  }
+
+  // Appends an element. If appending throws, the split_vector is unchanged.
+  template <class H, class C>
+  reference emplace_back(H&& hot, C&& cold) {
+    hot_.emplace_back(std::forward<H>(hot));
+    try {
+      cold_.emplace_back(std::forward<C>(cold));
+    } catch (...) {
+      hot_.pop_back();
+      throw;
+    }
+    return back();
+  }
+
+  void push_back(const value_type& value) {
+    emplace_back(value.hot, value.cold);
+  }
+
+  void push_back(value_type&& value) {
+    emplace_back(std::move(value.hot), std::move(value.cold));
+  }
+
+  void pop_back() noexcept {
+    hot_.pop_back();
+    cold_.pop_back();
+  }
+
+  iterator erase(const_iterator position) {
+    const auto i = position - cbegin();
+    hot_.erase(hot_.begin() + i);
+    cold_.erase(cold_.begin() + i);
+    return begin() + i;
+  }
+
+  reference operator[](size_type i) noexcept { return {&hot_[i], &cold_[i]}; }
+  const_reference operator[](size_type i) const noexcept {
+    return {&hot_[i], &cold_[i]};
+  }
+
+  reference front() noexcept { return (*this)[0]; }
+  const_reference front() const noexcept { return (*this)[0]; }
+  reference back() noexcept { return (*this)[size() - 1]; }
+  const_reference back() const noexcept { return (*this)[size() - 1]; }
+
+  iterator begin() noexcept { return {hot_.data(), cold_.data()}; }
+  const_iterator begin() const noexcept { return cbegin(); }
+  const_iterator cbegin() const noexcept {
+    return {hot_.data(), cold_.data()};
+  }
+  iterator end() noexcept { return begin() + difference_type(size()); }
+  const_iterator end() const noexcept { return cend(); }
+  const_iterator cend() const noexcept {
+    return cbegin() + difference_type(size());
+  }
+
+  split_column<Hot> hot() noexcept { return {hot_.data(), hot_.size()}; }
+  split_column<const Hot> hot() const noexcept {
+    return {hot_.data(), hot_.size()};
+  }
+  split_column<Cold> cold() noexcept { return {cold_.data(), cold_.size()}; }
+  split_column<const Cold> cold() const noexcept {
+    return {cold_.data(), cold_.size()};
+  }
+
+  void swap(split_vector& other) noexcept {
+    hot_.swap(other.hot_);
+    cold_.swap(other.cold_);
+  }
+
+  friend void swap(split_vector& a, split_vector& b) noexcept { a.swap(b); }
+
+  friend bool operator==(const split_vector& a, const split_vector& b) {
+    return a.hot_ == b.hot_ && a.cold_ == b.cold_;
+  }
+
+  friend bool operator!=(const split_vector& a, const split_vector& b) {
+    return !(a == b);
+  }
+
+ private:
+  std::vector<Hot> hot_;
+  std::vector<Cold> cold_;
+};
+
+}  // namespace isocpp_p1950
+
+#endif  // ISOCPP_P1950_SPLIT_VECTOR_H
@@ -0,0 +1,309 @@
+#include "compact_indirect_value.h"
+
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+using isocpp_p1950::compact_indirect_value;
+
+namespace {
+
+struct Live {
+  static inline long count = 0;
+  Live() { ++count; }
+  Live(const Live&) { ++count; }
+  Live& operator=(const Live&) = default;
+  ~Live() { --count; }
+};
+
+struct ThrowsOnCopy {
+  ThrowsOnCopy() = default;
+  ThrowsOnCopy(const ThrowsOnCopy&) { throw std::runtime_error("copy"); }
+  Live live;
+};
+
+// Copy construction and assignment throw for a negative id.
+struct ThrowsOnAssign {
+  int id = 0;
+  explicit ThrowsOnAssign(int i) : id(i) {}
+  ThrowsOnAssign(const ThrowsOnAssign& other) : id(other.id) {
+    if (id < 0) throw std::runtime_error("copy");
+  }
+  ThrowsOnAssign& operator=(const ThrowsOnAssign& other) {
+    if (other.id < 0) throw std::runtime_error("assign");
+    id = other.id;
+    return *this;
+  }
+};
+
+struct AssignsInPlace : ThrowsOnAssign {
+  using ThrowsOnAssign::ThrowsOnAssign;
+};
+
+struct alignas(64) OverAligned {
+  int value = 0;
+};
+
+}  // namespace
+
+namespace isocpp_p1950 {
+template <>
+struct enable_copy_assign_in_place<AssignsInPlace> : std::true_type {};
+}  // namespace isocpp_p1950
+
+TEST_CASE("compact_indirect_value is the size of a 32-bit number",
+          "[compact.sizeof]") {
+  STATIC_REQUIRE(sizeof(compact_indirect_value<int>) == sizeof(std::uint32_t));
+  STATIC_REQUIRE(sizeof(compact_indirect_value<OverAligned>) ==
+                 sizeof(std::uint32_t));
+  STATIC_REQUIRE(isocpp_p1950::is_trivially_relocatable_v<
+                 compact_indirect_value<std::string>>);
+}
+
+TEST_CASE("compact_indirect_value has value semantics",
+          "[compact.semantics]") {
+  GIVEN("A compact_indirect_value") {
+    compact_indirect_value<std::string> a(std::in_place, "compact");
+
+    THEN("Copies are deep copies") {
+      compact_indirect_value<std::string> b(a);
+      REQUIRE(*b == "compact");
+      REQUIRE(&*a != &*b);
+      *b = "changed";
+      REQUIRE(*a == "compact");
+    }
+
+    THEN("Copy assignment to an empty one copies the owned object") {
+      compact_indirect_value<std::string> b;
+      b = a;
+      REQUIRE(*b == "compact");
+      REQUIRE(&*a != &*b);
+    }
+
+    THEN("Copy assignment to a full one copies the owned object") {
+      compact_indirect_value<std::string> b(std::in_place, "other");
+      b = a;
+      REQUIRE(*b == "compact");
+      REQUIRE(&*a != &*b);
+    }
+
+    THEN("Moving leaves the source empty and the owned object in place") {
+      const std::string* location = &*a;
+      compact_indirect_value<std::string> b(std::move(a));
+      REQUIRE(!a);
+      REQUIRE(&*b == location);
+
+      compact_indirect_value<std::string> c;
+      c = std::move(b);
+      REQUIRE(!b);
+      REQUIRE(&*c == location);
+    }
+
+    THEN("emplace replaces the owned object") {
+      REQUIRE(a.emplace(3, 'x') == "xxx");
+      REQUIRE(*a == "xxx");
+    }
+
+    THEN("reset empties it") {
+      a.reset();
+      REQUIRE(!a.has_value());
+      REQUIRE_THROWS_AS(a.value(), isocpp_p1950::bad_indirect_value_access);
+    }
+
+    THEN("swap exchanges the owned objects") {
+      compact_indirect_value<std::string> b;
+      swap(a, b);
+      REQUIRE(!a);
+      REQUIRE(*b == "compact");
+    }
+  }
+}
+
+TEST_CASE("compact_indirect_value copy assignment reuses the owned object",
+          "[compact.assignment]") {
+  GIVEN("A type with a nothrow copy assignment") {
+    compact_indirect_value<int> a(std::in_place, 1);
+    compact_indirect_value<int> b(std::in_place, 2);
+    const int* location = &*b;
+
+    THEN("Copy assignment assigns the owned object") {
+      b = a;
+      REQUIRE(*b == 1);
+      REQUIRE(&*b == location);
+    }
+  }
+
+  GIVEN("A type whose copy assignment throws") {
+    compact_indirect_value<ThrowsOnAssign> a(std::in_place, 1);
+    compact_indirect_value<ThrowsOnAssign> b(std::in_place, 2);
+    const ThrowsOnAssign* location = &*b;
+
+    THEN("Copy assignment copies the owned object instead") {
+      b = a;
+      REQUIRE(b->id == 1);
+      REQUIRE(&*b != location);
+    }
+
+    THEN("A throwing copy leaves the target unchanged") {
+      a->id = -1;
+      REQUIRE_THROWS_AS(b = a, std::runtime_error);
+      REQUIRE(b->id == 2);
+    }
+  }
+
+  GIVEN("A type which opts into in-place copy assignment") {
+    compact_indirect_value<AssignsInPlace> a(std::in_place, 1);
+    compact_indirect_value<AssignsInPlace> b(std::in_place, 2);
+    const AssignsInPlace* location = &*b;
+
+    THEN("Copy assignment assigns the owned object") {
+      b = a;
+      REQUIRE(b->id == 1);
+      REQUIRE(&*b == location);
+    }
+  }
+}
+
+TEST_CASE("compact_indirect_value propagates constness", "[compact.const]") {
+  using CIV = compact_indirect_value<int>;
+  STATIC_REQUIRE(std::is_same_v<decltype(std::declval<CIV&>().operator->()),
+                                int*>);
+  STATIC_REQUIRE(
+      std::is_same_v<decltype(std::declval<const CIV&>().operator->()),
+                     const int*>);
+  STATIC_REQUIRE(std::is_same_v<decltype(*std::declval<const CIV&>()),
+                                const int&>);
+  STATIC_REQUIRE(std::is_same_v<decltype(std::declval<const CIV&&>().value()),
+                                const int&&>);
+}
+
+TEST_CASE("compact_indirect_value compares its owned objects",
+          "[compact.comparison]") {
+  const compact_indirect_value<int> empty;
+  const compact_indirect_value<int> one(std::in_place, 1);
+  const compact_indirect_value<int> two(std::in_place, 2);
+
+  REQUIRE(empty == compact_indirect_value<int>());
+  REQUIRE(one == compact_indirect_value<int>(std::in_place, 1));
+  REQUIRE(one != two);
+  REQUIRE(empty != one);
+  REQUIRE(empty < one);
+  REQUIRE(one < two);
+  REQUIRE(two > one);
+  REQUIRE(one <= one);
+  REQUIRE(two >= empty);
+
+  REQUIRE(empty == nullptr);
+  REQUIRE(nullptr != one);
+  REQUIRE(!(one < nullptr));
+  REQUIRE(nullptr < one);
+  REQUIRE(one > nullptr);
+  REQUIRE(!(nullptr > one));
+  REQUIRE(empty <= nullptr);
+  REQUIRE(nullptr <= one);
+  REQUIRE(one >= nullptr);
+  REQUIRE(nullptr >= empty);
+
+  REQUIRE(one == 1);
+  REQUIRE(2 == two);
+  REQUIRE(empty != 0);
+  REQUIRE(empty < 0);
+  REQUIRE(one < 2);
+  REQUIRE(3 > two);
+  REQUIRE(one <= 1);
+  REQUIRE(1 >= one);
+
+  REQUIRE(std::hash<compact_indirect_value<int>>{}(one) ==
+          std::hash<int>{}(1));
+  REQUIRE(std::hash<compact_indirect_value<int>>{}(empty) == 0);
+
+#if defined(__cpp_lib_three_way_comparison) && defined(__cpp_lib_concepts)
+  REQUIRE(std::is_lt(one <=> two));
+  REQUIRE(std::is_eq(one <=> compact_indirect_value<int>(std::in_place, 1)));
+  REQUIRE(std::is_lt(empty <=> one));
+  REQUIRE(std::is_eq(empty <=> compact_indirect_value<int>()));
+  REQUIRE(std::is_lt(one <=> 2));
+  REQUIRE(std::is_eq(two <=> 2));
+  REQUIRE(std::is_lt(empty <=> 0));
+  REQUIRE(std::is_eq(empty <=> nullptr));
+  REQUIRE(std::is_gt(one <=> nullptr));
+#endif
+}
+
+TEST_CASE("Owned objects are reused and released", "[compact.arena]") {
+  GIVEN("Many compact_indirect_values") {
+    std::vector<compact_indirect_value<Live>> values(1000);
+    for (auto& v : values) v.emplace();
+    REQUIRE(Live::count == 1000);
+
+    THEN("Their owned objects are distinct and keep their addresses") {
+      std::vector<const Live*> locations;
+      for (const auto& v : values) locations.push_back(&*v);
+      values.reserve(values.capacity() + 1);
+      for (std::size_t i = 0; i != values.size(); ++i) {
+        REQUIRE(&*values[i] == locations[i]);
+        if (i) REQUIRE(locations[i] != locations[i - 1]);
+      }
+    }
+
+    THEN("The slot of a destroyed object is reused") {
+      const Live* location = &*values.back();
+      values.pop_back();
+      compact_indirect_value<Live> v(std::in_place);
+      REQUIRE(&*v == location);
+    }
+  }
+  REQUIRE(Live::count == 0);
+
+  GIVEN("A type whose copy constructor throws") {
+    const compact_indirect_value<ThrowsOnCopy> v(std::in_place);
+    REQUIRE_THROWS_AS(compact_indirect_value<ThrowsOnCopy>(v),
+                      std::runtime_error);
+    THEN("The slot of the failed copy is reused") {
+      const compact_indirect_value<ThrowsOnCopy> w(std::in_place);
+      REQUIRE(Live::count == 2);
+    }
+  }
+
+  GIVEN("An over-aligned type") {
+    std::vector<compact_indirect_value<OverAligned>> values(100);
+    for (auto& v : values) {
+      v.emplace();
+      REQUIRE(reinterpret_cast<std::uintptr_t>(&*v) % alignof(OverAligned) ==
+              0);
+    }
+  }
+}
+
+TEST_CASE("compact_indirect_values are created and destroyed concurrently",
+          "[compact.concurrency]") {
+  constexpr int threads = 4;
+  constexpr int per_thread = 10000;
+  std::vector<std::vector<compact_indirect_value<int>>> produced(threads);
+  std::vector<std::thread> workers;
+  for (int t = 0; t != threads; ++t) {
+    workers.emplace_back([t, &produced] {
+      for (int i = 0; i != per_thread; ++i) {
+        produced[t].emplace_back(std::in_place, t * per_thread + i);
+        if (i % 3 == 0) produced[t].pop_back();
+      }
+    });
+  }
+  for (auto& w : workers) w.join();
+
+  for (int t = 0; t != threads; ++t) {
+    int i = 0;
+    for (const auto& v : produced[t]) {
+      if (i % 3 == 0) ++i;
+      REQUIRE(*v == t * per_thread + i);
+      ++i;
+    }
+  }
+}
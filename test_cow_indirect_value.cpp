@@ -0,0 +1,248 @@
+#include "cow_indirect_value.h"
+
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+using isocpp_p1950::cow_indirect_value;
+using isocpp_p1950::non_atomic_ref_count;
+
+namespace {
+
+struct CopyCounted {
+  static inline int copies = 0;
+
+  int value = 0;
+
+  explicit CopyCounted(int v) : value(v) {}
+  CopyCounted(const CopyCounted& c) : value(c.value) { ++copies; }
+  CopyCounted& operator=(const CopyCounted&) = default;
+
+  friend bool operator==(const CopyCounted& a, const CopyCounted& b) {
+    return a.value == b.value;
+  }
+};
+
+}  // namespace
+
+TEMPLATE_TEST_CASE("Copies share the owned object until it is modified",
+                   "[cow_indirect_value.copy]", isocpp_p1950::atomic_ref_count,
+                   isocpp_p1950::non_atomic_ref_count) {
+  using cow = cow_indirect_value<CopyCounted, TestType>;
+
+  GIVEN("A cow_indirect_value and a copy of it") {
+    CopyCounted::copies = 0;
+    const cow a(std::in_place, 42);
+    cow b(a);
+
+    THEN("The copy shares the owned object") {
+      REQUIRE(CopyCounted::copies == 0);
+      REQUIRE(a.use_count() == 2);
+      REQUIRE(&*a == &*std::as_const(b));
+      REQUIRE(a == b);
+    }
+
+    WHEN("The copy is modified") {
+      b->value = 7;
+      THEN("The owned object is copied once and the original is unchanged") {
+        REQUIRE(CopyCounted::copies == 1);
+        REQUIRE(a->value == 42);
+        REQUIRE(b->value == 7);
+        REQUIRE(a.use_count() == 1);
+        REQUIRE(b.use_count() == 1);
+      }
+    }
+
+    WHEN("The copy is destroyed") {
+      cow c(std::move(b));
+      c = cow();
+      THEN("The original owns its object alone") {
+        REQUIRE(!b);
+        REQUIRE(!c);
+        REQUIRE(a.use_count() == 1);
+        REQUIRE(a->value == 42);
+      }
+    }
+  }
+
+  GIVEN("A cow_indirect_value which is not shared") {
+    CopyCounted::copies = 0;
+    cow a(std::in_place, 1);
+
+    WHEN("It is modified") {
+      a->value = 2;
+      THEN("Nothing is copied") {
+        REQUIRE(CopyCounted::copies == 0);
+        REQUIRE(a->value == 2);
+      }
+    }
+  }
+}
+
+TEST_CASE("A reference from non-const access is never shared",
+          "[cow_indirect_value.copy]") {
+  cow_indirect_value<std::string> a(std::in_place, "hello");
+  std::string& ref = *a;
+
+  cow_indirect_value<std::string> b(a);
+  ref = "world";
+
+  REQUIRE(*a == "world");
+  REQUIRE(*b == "hello");
+  REQUIRE(a.use_count() == 1);
+  REQUIRE(b.use_count() == 1);
+}
+
+TEST_CASE("Copies of a modified cow_indirect_value are shared again",
+          "[cow_indirect_value.copy]") {
+  using cow = cow_indirect_value<CopyCounted, non_atomic_ref_count>;
+  CopyCounted::copies = 0;
+  cow a(std::in_place, 1);
+  a->value = 2;
+
+  GIVEN("A copy of the modified value") {
+    cow b(a);
+    REQUIRE(CopyCounted::copies == 1);
+
+    THEN("Copies of the copy share its owned object") {
+      cow c(b);
+      REQUIRE(CopyCounted::copies == 1);
+      REQUIRE(b.use_count() == 2);
+      REQUIRE(c->value == 2);
+    }
+  }
+
+  GIVEN("The modified value with a copy assigned to it") {
+    a = cow(a);
+    REQUIRE(CopyCounted::copies == 1);
+
+    THEN("Its copies share its owned object") {
+      cow b(a);
+      REQUIRE(CopyCounted::copies == 1);
+      REQUIRE(a.use_count() == 2);
+    }
+  }
+}
+
+TEST_CASE("Assignment, swap and comparison of cow_indirect_value",
+          "[cow_indirect_value.assign]") {
+  using cow = cow_indirect_value<int, non_atomic_ref_count>;
+  cow a(std::in_place, 1);
+  cow b(std::in_place, 2);
+  cow empty;
+
+  b = std::as_const(a);
+  REQUIRE(a.use_count() == 2);
+  REQUIRE(*b == 1);
+
+  b = empty;
+  REQUIRE(!b);
+  REQUIRE(b.use_count() == 0);
+  REQUIRE(a.use_count() == 1);
+
+  swap(a, b);
+  REQUIRE(!a);
+  REQUIRE(*b == 1);
+
+  REQUIRE(a == nullptr);
+  REQUIRE(b != nullptr);
+  REQUIRE(a < b);
+  REQUIRE(b == cow(std::in_place, 1));
+  REQUIRE(b != cow(std::in_place, 2));
+  REQUIRE(std::hash<cow>{}(b) == std::hash<int>{}(1));
+  REQUIRE_THROWS_AS(a.value(), isocpp_p1950::bad_indirect_value_access);
+  REQUIRE(a.operator->() == nullptr);
+  REQUIRE(std::as_const(a).operator->() == nullptr);
+}
+
+TEST_CASE("cow_indirect_value compares as indirect_value does",
+          "[cow_indirect_value.relational]") {
+  using cow = cow_indirect_value<double, non_atomic_ref_count>;
+  const cow one(std::in_place, 1.0);
+  const cow empty;
+
+  GIVEN("Copies sharing a NaN") {
+    const cow nan(std::in_place, std::numeric_limits<double>::quiet_NaN());
+    const cow copy(nan);
+    const isocpp_p1950::indirect_value<double> unshared(std::in_place, *nan);
+    REQUIRE(copy.use_count() == 2);
+
+    THEN("They compare unequal, as indirect_values of a NaN do") {
+      REQUIRE(!(nan == copy));
+      REQUIRE(nan != copy);
+      REQUIRE(!(unshared == unshared));
+      REQUIRE(!(nan == unshared));
+    }
+  }
+
+  GIVEN("A cow_indirect_value and values of its value type") {
+    THEN("It compares as its owned object") {
+      REQUIRE(one == 1.0);
+      REQUIRE(1.0 == one);
+      REQUIRE(one != 2.0);
+      REQUIRE(2.0 != one);
+      REQUIRE(one < 2.0);
+      REQUIRE(0.0 < one);
+      REQUIRE(one > 0.0);
+      REQUIRE(2.0 > one);
+      REQUIRE(one <= 1.0);
+      REQUIRE(1.0 >= one);
+    }
+
+    THEN("An empty one compares less than any value") {
+      REQUIRE(empty != 0.0);
+      REQUIRE(empty < 0.0);
+      REQUIRE(0.0 > empty);
+    }
+  }
+
+  GIVEN("A cow_indirect_value and nullptr") {
+    THEN("Only an empty one is ordered equal to nullptr") {
+      REQUIRE(nullptr == empty);
+      REQUIRE(nullptr != one);
+      REQUIRE(nullptr < one);
+      REQUIRE(one > nullptr);
+      REQUIRE(empty <= nullptr);
+      REQUIRE(nullptr >= empty);
+    }
+  }
+
+#if defined(__cpp_lib_three_way_comparison) && defined(__cpp_lib_concepts)
+  GIVEN("Three-way comparison") {
+    THEN("It orders as the relational operators do") {
+      REQUIRE(std::is_lt(one <=> 2.0));
+      REQUIRE(std::is_eq(one <=> 1.0));
+      REQUIRE(std::is_lt(empty <=> 0.0));
+      REQUIRE(std::is_gt(one <=> empty));
+      REQUIRE(std::is_eq(empty <=> nullptr));
+      REQUIRE(std::is_gt(one <=> nullptr));
+    }
+  }
+#endif
+}
+
+TEST_CASE("cow_indirect_value copies may be used from different threads",
+          "[cow_indirect_value.threads]") {
+  const cow_indirect_value<std::vector<int>> shared(std::in_place, 1000, 1);
+  std::vector<int> sums(4);
+  std::vector<std::thread> threads;
+  for (int& sum : sums) {
+    threads.emplace_back([&sum, copy = shared]() mutable {
+      for (int i = 0; i < 1000; ++i) {
+        cow_indirect_value<std::vector<int>> snapshot(copy);
+        for (int x : *std::as_const(snapshot)) sum += x;
+      }
+      // Copy and modify the vector of this thread only.
+      copy->push_back(1);
+      sum += static_cast<int>(copy->size());
+    });
+  }
+  for (auto& t : threads) t.join();
+
+  for (int sum : sums) REQUIRE(sum == 1000 * 1000 + 1001);
+  REQUIRE(shared->size() == 1000);
+  REQUIRE(shared.use_count() == 1);
+}
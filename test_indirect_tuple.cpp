@@ -0,0 +1,189 @@
+#include "indirect_tuple.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+using isocpp_p1950::indirect_tuple;
+using isocpp_p1950::make_indirect_tuple;
+
+namespace {
+
+struct Cold {
+  std::string description;
+  std::vector<int> history;
+  double statistics[8] = {};
+};
+
+}  // namespace
+
+TEST_CASE("indirect_tuple holds all members behind one pointer",
+          "[indirect_tuple.layout]") {
+  STATIC_REQUIRE(sizeof(indirect_tuple<Cold, std::string, int>) ==
+                 sizeof(void*));
+
+  const auto t = make_indirect_tuple(Cold{}, std::string("name"), 42);
+  const auto begin = reinterpret_cast<std::uintptr_t>(&*t);
+  const auto end = begin + sizeof(*t);
+  for (auto address : {reinterpret_cast<std::uintptr_t>(&t.get<0>()),
+                       reinterpret_cast<std::uintptr_t>(&t.get<1>()),
+                       reinterpret_cast<std::uintptr_t>(&t.get<2>())}) {
+    REQUIRE(address >= begin);
+    REQUIRE(address < end);
+  }
+}
+
+TEST_CASE("indirect_tuple has value semantics", "[indirect_tuple.copy]") {
+  GIVEN("An indirect_tuple") {
+    indirect_tuple<std::string, int> a(std::in_place, "cold", 1);
+
+    WHEN("It is copied") {
+      auto b = a;
+
+      THEN("The copy holds copies of all members") {
+        REQUIRE(b == a);
+        REQUIRE(&*b != &*a);
+        REQUIRE(b.get<std::string>() == "cold");
+        REQUIRE(b.get<int>() == 1);
+      }
+
+      THEN("Changing the copy leaves the original unchanged") {
+        b.get<0>() = "changed";
+        b.get<1>() = 2;
+        REQUIRE(a.get<0>() == "cold");
+        REQUIRE(a.get<1>() == 1);
+        REQUIRE(b != a);
+      }
+    }
+
+    WHEN("It is moved from") {
+      auto b = std::move(a);
+
+      THEN("The source is empty") {
+        REQUIRE(!a);
+        REQUIRE(b.has_value());
+        REQUIRE(isocpp_p1950::get<0>(b) == "cold");
+      }
+    }
+  }
+
+  GIVEN("A default constructed indirect_tuple") {
+    indirect_tuple<std::string, int> a;
+
+    THEN("It is empty until emplaced") {
+      REQUIRE(!a.has_value());
+      REQUIRE_THROWS_AS(a.value(), isocpp_p1950::bad_indirect_value_access);
+      a.emplace("x", 3);
+      REQUIRE(a.get<int>() == 3);
+    }
+  }
+}
+
+TEST_CASE("indirect_tuple propagates const", "[indirect_tuple.const]") {
+  using T = indirect_tuple<std::string, int>;
+  STATIC_REQUIRE(
+      std::is_same_v<decltype(std::declval<T&>().get<0>()), std::string&>);
+  STATIC_REQUIRE(std::is_same_v<decltype(std::declval<const T&>().get<0>()),
+                                const std::string&>);
+  STATIC_REQUIRE(std::is_same_v<decltype(isocpp_p1950::get<int>(
+                                    std::declval<const T&>())),
+                                const int&>);
+  STATIC_REQUIRE(
+      std::is_same_v<decltype(*std::declval<const T&>()),
+                     const std::tuple<std::string, int>&>);
+}
+
+TEST_CASE("indirect_tuple supports structured bindings",
+          "[indirect_tuple.bindings]") {
+  indirect_tuple<std::string, int> t(std::in_place, "name", 7);
+  auto& [name, number] = t;
+  name += "!";
+  ++number;
+  REQUIRE(t.get<0>() == "name!");
+  REQUIRE(t.get<1>() == 8);
+}
+
+TEST_CASE("indirect_tuple compares as indirect_value does",
+          "[indirect_tuple.relational]") {
+  using T = indirect_tuple<std::string, int>;
+  const T a(std::in_place, "a", 1);
+  const T b(std::in_place, "b", 0);
+  const T empty;
+
+  GIVEN("Two indirect_tuples") {
+    THEN("They compare their members lexicographically") {
+      REQUIRE(a < b);
+      REQUIRE(b > a);
+      REQUIRE(a <= a);
+      REQUIRE(b >= a);
+      REQUIRE(!(b < a));
+    }
+
+    THEN("An empty one compares less than a non-empty one") {
+      REQUIRE(empty == T());
+      REQUIRE(empty < a);
+      REQUIRE(a > empty);
+      REQUIRE(empty <= T());
+      REQUIRE(!(empty < T()));
+    }
+  }
+
+  GIVEN("An indirect_tuple and values of its tuple_type") {
+    const std::tuple<std::string, int> value("a", 1);
+
+    THEN("It compares as its members") {
+      REQUIRE(a == value);
+      REQUIRE(value == a);
+      REQUIRE(b != value);
+      REQUIRE(value < b);
+      REQUIRE(b > value);
+      REQUIRE(empty < value);
+      REQUIRE(empty != value);
+    }
+  }
+
+  GIVEN("An indirect_tuple and nullptr") {
+    THEN("Only an empty one is ordered equal to nullptr") {
+      REQUIRE(empty == nullptr);
+      REQUIRE(nullptr != a);
+      REQUIRE(nullptr < a);
+      REQUIRE(a > nullptr);
+      REQUIRE(empty <= nullptr);
+      REQUIRE(nullptr >= empty);
+    }
+  }
+
+#if defined(__cpp_lib_three_way_comparison) && defined(__cpp_lib_concepts)
+  GIVEN("Three-way comparison") {
+    THEN("It orders as the relational operators do") {
+      REQUIRE(std::is_lt(a <=> b));
+      REQUIRE(std::is_eq(a <=> T(std::in_place, "a", 1)));
+      REQUIRE(std::is_lt(empty <=> a));
+      REQUIRE(std::is_gt(b <=> std::tuple<std::string, int>("a", 9)));
+      REQUIRE(std::is_eq(empty <=> nullptr));
+      REQUIRE(std::is_gt(a <=> nullptr));
+    }
+  }
+#endif
+}
+
+TEST_CASE("indirect_tuple is hashed by its members",
+          "[indirect_tuple.hash]") {
+  using T = indirect_tuple<std::string, int>;
+  const std::hash<T> hash;
+
+  REQUIRE(hash(T()) == 0);
+  REQUIRE(hash(T(std::in_place, "a", 1)) == hash(T(std::in_place, "a", 1)));
+  REQUIRE(hash(T(std::in_place, "a", 1)) != hash(T(std::in_place, "a", 2)));
+  REQUIRE(hash(T(std::in_place, "a", 1)) != hash(T(std::in_place, "b", 1)));
+
+  STATIC_REQUIRE(std::is_default_constructible_v<std::hash<T>>);
+  STATIC_REQUIRE(
+      !std::is_default_constructible_v<std::hash<indirect_tuple<Cold, int>>>);
+}
@@ -1,5 +1,7 @@
 #include <functional>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include "indirect_value.h"
 
@@ -888,6 +890,14 @@ TEST_CASE("Protection against reentrancy", "[TODO]") {
 
   struct Reentrance {
     indirect_value<Reentrance>* backReference{};
+    Reentrance() = default;
+    Reentrance(const Reentrance&) = default;
+    // A potentially throwing copy assignment keeps copy assignment of
+    // indirect_value from reusing the held value.
+    Reentrance& operator=(const Reentrance& other) {
+      backReference = other.backReference;
+      return *this;
+    }
     ~Reentrance() { REQUIRE(backReference->has_value() == false); }
   };
 
@@ -1415,3 +1425,705 @@ TEST_CASE("Hash for indirect_value", "[TODO]") {
         !IsHashable<indirect_value<ProvidesThrowingHash>>::IsNoexcept);
   }
 }
+
+struct allocation_counts {
+  int allocations = 0;
+  int deallocations = 0;
+};
+
+// A stateful allocator which counts its allocations in an external record.
+template <class T>
+struct counting_allocator {
+  using value_type = T;
+
+  allocation_counts* counts;
+
+  explicit counting_allocator(allocation_counts* c) noexcept : counts(c) {}
+  template <class U>
+  counting_allocator(const counting_allocator<U>& other) noexcept
+      : counts(other.counts) {}
+
+  T* allocate(std::size_t n) {
+    ++counts->allocations;
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept {
+    ++counts->deallocations;
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  template <class U>
+  friend bool operator==(const counting_allocator& lhs,
+                         const counting_allocator<U>& rhs) noexcept {
+    return lhs.counts == rhs.counts;
+  }
+
+  template <class U>
+  friend bool operator!=(const counting_allocator& lhs,
+                         const counting_allocator<U>& rhs) noexcept {
+    return lhs.counts != rhs.counts;
+  }
+};
+
+TEST_CASE("Allocator-aware indirect_value", "[indirect_value.allocator]") {
+  using isocpp_p1950::allocate_indirect_value;
+  using isocpp_p1950::allocator_copy;
+  using isocpp_p1950::allocator_delete;
+
+  GIVEN("An indirect_value using std::allocator") {
+    using IV = indirect_value<int, allocator_copy<int>, allocator_delete<int>>;
+
+    THEN("It uses the minimum space requirements") {
+      REQUIRE(static_test<sizeof(IV) == sizeof(int*)>());
+    }
+
+    THEN("In-place construction and copies work as for indirect_value") {
+      IV a(std::in_place, 42);
+      IV b(a);
+      REQUIRE(*a == 42);
+      REQUIRE(*b == 42);
+      REQUIRE(&*a != &*b);
+    }
+  }
+
+  GIVEN("An indirect_value created with a stateful allocator") {
+    allocation_counts counts;
+    auto a = allocate_indirect_value<int>(
+        counting_allocator<char>(&counts), 42);
+    REQUIRE(*a == 42);
+    REQUIRE(counts.allocations == 1);
+    REQUIRE(a.get_copier().get_allocator().counts == &counts);
+    REQUIRE(a.get_deleter().get_allocator().counts == &counts);
+
+    WHEN("It is copy constructed") {
+      auto b = a;
+      THEN("The copy reuses the allocator of the source") {
+        REQUIRE(*b == 42);
+        REQUIRE(counts.allocations == 2);
+        REQUIRE(b.get_copier().get_allocator().counts == &counts);
+        REQUIRE(b.get_deleter().get_allocator().counts == &counts);
+      }
+    }
+
+    WHEN("It is copy assigned to an indirect_value with another allocator") {
+      allocation_counts other_counts;
+      auto b = allocate_indirect_value<int>(
+          counting_allocator<int>(&other_counts), 7);
+      b = a;
+      THEN("The old object is released to its own allocator") {
+        REQUIRE(*b == 42);
+        REQUIRE(other_counts.allocations == 1);
+        REQUIRE(other_counts.deallocations == 1);
+        REQUIRE(counts.allocations == 2);
+        REQUIRE(b.get_deleter().get_allocator().counts == &counts);
+      }
+    }
+
+    WHEN("It is moved") {
+      auto b = std::move(a);
+      THEN("No allocation happens") {
+        REQUIRE(*b == 42);
+        REQUIRE(!a);
+        REQUIRE(counts.allocations == 1);
+      }
+    }
+  }
+
+  GIVEN("An allocator and a throwing constructor") {
+    allocation_counts counts;
+    struct Throws {
+      explicit Throws(int) { throw 0; }
+    };
+    THEN("The memory is returned to the allocator") {
+      REQUIRE_THROWS_AS(allocate_indirect_value<Throws>(
+                            counting_allocator<Throws>(&counts), 0),
+                        int);
+      REQUIRE(counts.allocations == 1);
+      REQUIRE(counts.deallocations == 1);
+    }
+  }
+
+  GIVEN("A scope with indirect_values created with an allocator") {
+    allocation_counts counts;
+    {
+      auto a = allocate_indirect_value<int>(counting_allocator<int>(&counts));
+      auto b = a;
+      auto c = std::move(b);
+    }
+    THEN("Every allocation is deallocated") {
+      REQUIRE(counts.allocations == 2);
+      REQUIRE(counts.deallocations == 2);
+    }
+  }
+}
+
+#ifdef __cpp_lib_memory_resource
+// A memory resource which counts the allocations made from it.
+class counting_resource : public std::pmr::memory_resource {
+ public:
+  int allocations = 0;
+  int deallocations = 0;
+
+ private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    ++allocations;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes,
+                     std::size_t alignment) override {
+    ++deallocations;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+
+// Installs a memory resource as the default resource for a scope.
+class scoped_default_resource {
+ public:
+  explicit scoped_default_resource(std::pmr::memory_resource* r)
+      : previous_(std::pmr::set_default_resource(r)) {}
+  ~scoped_default_resource() { std::pmr::set_default_resource(previous_); }
+
+ private:
+  std::pmr::memory_resource* previous_;
+};
+
+TEST_CASE("pmr::indirect_value", "[indirect_value.pmr]") {
+  using isocpp_p1950::allocate_indirect_value;
+  using PmrIV = isocpp_p1950::pmr::indirect_value<int>;
+
+  THEN("It is the size of a pointer and a memory resource pointer") {
+    REQUIRE(static_test<sizeof(PmrIV) == 2 * sizeof(void*)>());
+  }
+
+  GIVEN("A pmr::indirect_value allocated from a memory resource") {
+    counting_resource default_resource;
+    scoped_default_resource scope(&default_resource);
+
+    counting_resource resource;
+    PmrIV a(std::allocator_arg, &resource, 42);
+    REQUIRE(*a == 42);
+    REQUIRE(resource.allocations == 1);
+    REQUIRE(a.get_deleter().get_allocator().resource() == &resource);
+
+    WHEN("It is copy constructed") {
+      PmrIV b(a);
+      THEN("The copy is allocated from the default resource") {
+        REQUIRE(*b == 42);
+        REQUIRE(resource.allocations == 1);
+        REQUIRE(default_resource.allocations == 1);
+        REQUIRE(b.get_deleter().get_allocator().resource() ==
+                &default_resource);
+      }
+    }
+
+    WHEN("It is moved") {
+      PmrIV b(std::move(a));
+      THEN("The memory resource moves with the owned object") {
+        REQUIRE(*b == 42);
+        REQUIRE(b.get_deleter().get_allocator().resource() == &resource);
+        REQUIRE(default_resource.allocations == 0);
+      }
+    }
+
+    WHEN("It is destroyed") {
+      a = PmrIV();
+      THEN("The owned object is returned to its memory resource") {
+        REQUIRE(resource.deallocations == 1);
+        REQUIRE(default_resource.deallocations == 0);
+      }
+    }
+  }
+
+  GIVEN("A monotonic buffer resource") {
+    std::pmr::monotonic_buffer_resource arena;
+    auto a = allocate_indirect_value<int>(
+        std::pmr::polymorphic_allocator<std::byte>(&arena), 1);
+    auto b = allocate_indirect_value<int>(
+        std::pmr::polymorphic_allocator<std::byte>(&arena), 2);
+    THEN("allocate_indirect_value creates a pmr::indirect_value") {
+      static_assert(std::is_same_v<decltype(a), PmrIV>);
+      REQUIRE(*a == 1);
+      REQUIRE(*b == 2);
+      REQUIRE(a.get_deleter().get_allocator().resource() == &arena);
+    }
+  }
+}
+#endif
+
+struct CopyAssignmentThrows {
+  int id{};
+  CopyAssignmentThrows() = default;
+  CopyAssignmentThrows(const CopyAssignmentThrows&) = default;
+  CopyAssignmentThrows& operator=(const CopyAssignmentThrows& other) {
+    if (other.id < 0) throw 0;
+    id = other.id;
+    return *this;
+  }
+};
+
+struct BasicCopyAssignment : CopyAssignmentThrows {};
+
+namespace isocpp_p1950 {
+template <>
+struct enable_copy_assign_in_place<BasicCopyAssignment> : std::true_type {};
+}  // namespace isocpp_p1950
+
+TEST_CASE("Copy assignment reuses the held value",
+          "[assignment.copy.in_place]") {
+  GIVEN("Two engaged indirect_values of a nothrow copy assignable type") {
+    indirect_value<int> a(std::in_place, 5);
+    indirect_value<int> b(std::in_place, 10);
+    const int* const location_of_b = b.operator->();
+
+    THEN("Copy assignment assigns into the existing held value") {
+      b = a;
+      REQUIRE(*b == 5);
+      REQUIRE(b.operator->() == location_of_b);
+      REQUIRE(a.operator->() != b.operator->());
+    }
+  }
+
+  GIVEN("An engaged indirect_value with a custom copier") {
+    indirect_value<int, copy_counter<int>> a(std::in_place, 5);
+    indirect_value<int, copy_counter<int>> b(std::in_place, 10);
+    const size_t copies = copy_counter<int>::call_count;
+
+    THEN("Copy assignment goes through the copier") {
+      b = a;
+      REQUIRE(*b == 5);
+      REQUIRE(copy_counter<int>::call_count == copies + 1);
+    }
+  }
+
+  GIVEN("A type whose copy assignment may throw") {
+    indirect_value<CopyAssignmentThrows> a(std::in_place);
+    a->id = 1;
+    indirect_value<CopyAssignmentThrows> b(std::in_place);
+    b->id = 2;
+    const auto* const location_of_b = b.operator->();
+
+    THEN("Copy assignment makes a new copy") {
+      b = a;
+      REQUIRE(b->id == 1);
+      REQUIRE(b.operator->() != location_of_b);
+    }
+  }
+
+  GIVEN("A type which opts into in-place copy assignment") {
+    indirect_value<BasicCopyAssignment> a(std::in_place);
+    a->id = 1;
+    indirect_value<BasicCopyAssignment> b(std::in_place);
+    b->id = 2;
+    const auto* const location_of_b = b.operator->();
+
+    THEN("Copy assignment reuses the held value") {
+      b = a;
+      REQUIRE(b->id == 1);
+      REQUIRE(b.operator->() == location_of_b);
+    }
+
+    THEN("A throwing copy assignment leaves the held value in place") {
+      a->id = -1;
+      REQUIRE_THROWS_AS(b = a, int);
+      REQUIRE(b);
+      REQUIRE(b.operator->() == location_of_b);
+    }
+  }
+}
+
+// A polymorphic type with nothrow construction and assignment, whose owned
+// objects may be of a derived type, and so may not be reused in place.
+struct ReusableBase {
+  int id = 0;
+  explicit ReusableBase(int i = 0) noexcept : id(i) {}
+  virtual ~ReusableBase() = default;
+  ReusableBase(const ReusableBase&) = default;
+  ReusableBase& operator=(const ReusableBase&) = default;
+  virtual bool derived() const noexcept { return false; }
+};
+
+struct ReusableDerived : ReusableBase {
+  inline static int destroyed = 0;
+  std::vector<int> extra = std::vector<int>(16);
+  ~ReusableDerived() override { ++destroyed; }
+  bool derived() const noexcept override { return true; }
+};
+
+TEST_CASE("Assigning a value to an indirect_value", "[assignment.value]") {
+  GIVEN("An empty indirect_value") {
+    indirect_value<std::string> iv;
+
+    THEN("Assigning a value creates an owned object") {
+      const std::string value = "value";
+      iv = value;
+      REQUIRE(iv);
+      REQUIRE(*iv == "value");
+    }
+  }
+
+  GIVEN("An engaged indirect_value") {
+    indirect_value<std::string> iv(std::in_place, "first");
+    const std::string* const location = iv.operator->();
+
+    THEN("Assigning an lvalue reuses the owned object") {
+      const std::string value = "second";
+      iv = value;
+      REQUIRE(*iv == "second");
+      REQUIRE(iv.operator->() == location);
+    }
+
+    THEN("Assigning an rvalue reuses the owned object") {
+      std::string value = "third";
+      iv = std::move(value);
+      REQUIRE(*iv == "third");
+      REQUIRE(iv.operator->() == location);
+    }
+
+    THEN("Assigning an empty braced list empties the indirect_value") {
+      iv = {};
+      REQUIRE(!iv);
+    }
+  }
+}
+
+TEST_CASE("Emplacing into an indirect_value", "[modifiers.emplace]") {
+  GIVEN("An empty indirect_value") {
+    indirect_value<std::string> iv;
+
+    THEN("emplace creates an owned object") {
+      std::string& s = iv.emplace(3, 'x');
+      REQUIRE(&s == iv.operator->());
+      REQUIRE(*iv == "xxx");
+    }
+  }
+
+  GIVEN("An engaged indirect_value of a nothrow constructible type") {
+    indirect_value<int> iv(std::in_place, 1);
+    const int* const location = iv.operator->();
+
+    THEN("emplace constructs into the existing storage") {
+      iv.emplace(2);
+      REQUIRE(*iv == 2);
+      REQUIRE(iv.operator->() == location);
+    }
+  }
+
+  GIVEN("An engaged indirect_value of a nothrow move assignable type") {
+    indirect_value<std::string> iv(std::in_place, "first");
+    const std::string* const location = iv.operator->();
+
+    THEN("emplace move assigns into the existing owned object") {
+      iv.emplace("second");
+      REQUIRE(*iv == "second");
+      REQUIRE(iv.operator->() == location);
+    }
+  }
+
+  GIVEN("An engaged indirect_value of a type without nothrow construction") {
+    indirect_value<CopyConstructorThrows> iv(std::in_place);
+    iv->id = 1;
+    const CopyConstructorThrows other;
+
+    THEN("A throwing constructor leaves the indirect_value unchanged") {
+      REQUIRE_THROWS_AS(iv.emplace(other), int);
+      REQUIRE(iv->id == 1);
+    }
+  }
+
+  GIVEN("An empty indirect_value with an allocator") {
+    allocation_counts counts;
+    auto iv = isocpp_p1950::allocate_indirect_value<int>(
+        counting_allocator<int>(&counts), 1);
+    iv.reset();
+    REQUIRE(counts.deallocations == 1);
+
+    THEN("emplace allocates with the allocator of the deleter") {
+      iv.emplace(2);
+      REQUIRE(*iv == 2);
+      REQUIRE(counts.allocations == 2);
+    }
+
+    THEN("emplace replaces an owned object through the allocator") {
+      iv.emplace(2);
+      iv.emplace(3);
+      REQUIRE(*iv == 3);
+      REQUIRE(counts.allocations == 3);
+      REQUIRE(counts.deallocations == 2);
+    }
+  }
+
+  GIVEN("An engaged indirect_value with a counting deleter") {
+    indirect_value<int, copy_counter<int>, delete_counter<int>> iv(
+        std::in_place, 1);
+    const size_t deletes = delete_counter<int>::call_count;
+
+    THEN("emplace destroys the old owned object with the deleter") {
+      iv.emplace(2);
+      REQUIRE(*iv == 2);
+      REQUIRE(delete_counter<int>::call_count == deletes + 1);
+    }
+
+    THEN("Assigning a value destroys the old owned object with the deleter") {
+      iv = 3;
+      REQUIRE(*iv == 3);
+      REQUIRE(delete_counter<int>::call_count == deletes + 1);
+    }
+  }
+
+  GIVEN("An indirect_value of a base class owning a derived object") {
+    indirect_value<ReusableBase> iv(
+        static_cast<ReusableBase*>(new ReusableDerived));
+    const int destroyed = ReusableDerived::destroyed;
+
+    THEN("emplace replaces the derived object with a new base object") {
+      iv.emplace(2);
+      REQUIRE(iv->id == 2);
+      REQUIRE(!iv->derived());
+      REQUIRE(ReusableDerived::destroyed == destroyed + 1);
+    }
+
+    THEN("Assigning a value replaces the derived object") {
+      iv = ReusableBase(3);
+      REQUIRE(iv->id == 3);
+      REQUIRE(!iv->derived());
+      REQUIRE(ReusableDerived::destroyed == destroyed + 1);
+    }
+
+    THEN("Copy assignment replaces the derived object") {
+      const indirect_value<ReusableBase> other(std::in_place, 4);
+      iv = other;
+      REQUIRE(iv->id == 4);
+      REQUIRE(!iv->derived());
+      REQUIRE(ReusableDerived::destroyed == destroyed + 1);
+    }
+  }
+}
+
+TEST_CASE("Resetting an indirect_value", "[modifiers.reset]") {
+  indirect_value<int, copy_counter<int>, delete_counter<int>> iv(
+      std::in_place, 1);
+  const size_t deletes = delete_counter<int>::call_count;
+
+  iv.reset();
+  REQUIRE(!iv);
+  REQUIRE(delete_counter<int>::call_count == deletes + 1);
+
+  iv.reset();
+  REQUIRE(delete_counter<int>::call_count == deletes + 1);
+}
+
+TEST_CASE("make_indirect_value", "[indirect_value.creation]") {
+  using isocpp_p1950::make_indirect_value;
+  using isocpp_p1950::make_indirect_value_for_overwrite;
+
+  GIVEN("Constructor arguments") {
+    auto iv = make_indirect_value<std::string>(3, 'x');
+    THEN("The owned object is constructed from them") {
+      static_assert(std::is_same_v<decltype(iv), indirect_value<std::string>>);
+      REQUIRE(*iv == "xxx");
+    }
+  }
+
+  GIVEN("No constructor arguments") {
+    auto iv = make_indirect_value<int>();
+    THEN("The owned object is value-initialized") { REQUIRE(*iv == 0); }
+  }
+
+  GIVEN("A type to be overwritten") {
+    struct Buffer {
+      int size = 4;
+      unsigned char data[4096];
+    };
+    auto iv = make_indirect_value_for_overwrite<Buffer>();
+    THEN("The owned object is default-initialized") {
+      REQUIRE(iv);
+      REQUIRE(iv->size == 4);
+    }
+  }
+}
+
+TEST_CASE("Trivial relocation of indirect_value", "[indirect_value.relocate]") {
+  using isocpp_p1950::is_trivially_relocatable_v;
+  using isocpp_p1950::uninitialized_relocate;
+
+  THEN("indirect_value is trivially relocatable when its copier and deleter "
+       "are") {
+    REQUIRE(static_test<is_trivially_relocatable_v<indirect_value<int>>>());
+    REQUIRE(static_test<is_trivially_relocatable_v<
+                indirect_value<int, isocpp_p1950::allocator_copy<int>,
+                               isocpp_p1950::allocator_delete<int>>>>());
+    REQUIRE(static_test<!is_trivially_relocatable_v<
+                indirect_value<int, CopierWithCallback>>>());
+#ifdef __cpp_lib_memory_resource
+    REQUIRE(static_test<is_trivially_relocatable_v<
+                isocpp_p1950::pmr::indirect_value<int>>>());
+#endif
+  }
+
+  GIVEN("A buffer of indirect_values") {
+    using IV = indirect_value<int, copy_counter<int>, delete_counter<int>>;
+    alignas(IV) unsigned char source[3 * sizeof(IV)];
+    alignas(IV) unsigned char target[3 * sizeof(IV)];
+    IV* first = reinterpret_cast<IV*>(source);
+    IV* d_first = reinterpret_cast<IV*>(target);
+    for (int i = 0; i != 3; ++i) ::new (first + i) IV(std::in_place, i);
+    const int* const location = first[1].operator->();
+    const size_t copies = copy_counter<int>::call_count;
+    const size_t deletes = delete_counter<int>::call_count;
+
+    WHEN("It is relocated") {
+      IV* d_last = uninitialized_relocate(first, first + 3, d_first);
+      THEN("The owned objects move without copies or deletes") {
+        REQUIRE(d_last == d_first + 3);
+        REQUIRE(*d_first[0] == 0);
+        REQUIRE(*d_first[1] == 1);
+        REQUIRE(*d_first[2] == 2);
+        REQUIRE(d_first[1].operator->() == location);
+        REQUIRE(copy_counter<int>::call_count == copies);
+        REQUIRE(delete_counter<int>::call_count == deletes);
+      }
+      for (IV* p = d_first; p != d_last; ++p) p->~IV();
+      REQUIRE(delete_counter<int>::call_count == deletes + 3);
+    }
+  }
+
+  GIVEN("A buffer of a type which is not trivially relocatable") {
+    using IV = indirect_value<int, CopierWithCallback>;
+    alignas(IV) unsigned char source[2 * sizeof(IV)];
+    alignas(IV) unsigned char target[2 * sizeof(IV)];
+    IV* first = reinterpret_cast<IV*>(source);
+    IV* d_first = reinterpret_cast<IV*>(target);
+    for (int i = 0; i != 2; ++i) ::new (first + i) IV(std::in_place, i);
+
+    THEN("It is relocated by moving") {
+      IV* d_last = uninitialized_relocate(first, first + 2, d_first);
+      REQUIRE(*d_first[0] == 0);
+      REQUIRE(*d_first[1] == 1);
+      for (IV* p = d_first; p != d_last; ++p) p->~IV();
+    }
+  }
+}
+
+namespace {
+
+struct DestructionCounter {
+  static inline std::size_t count = 0;
+  DestructionCounter() = default;
+  DestructionCounter(const DestructionCounter&) = default;
+  DestructionCounter& operator=(const DestructionCounter&) = default;
+  ~DestructionCounter() { ++count; }
+};
+
+struct ChainNode;
+using ChainLink =
+    indirect_value<ChainNode, isocpp_p1950::default_copy<ChainNode>,
+                   isocpp_p1950::iterative_delete<ChainNode>>;
+
+struct ChainNode {
+  ChainNode(int v, ChainLink n) : value(v), next(std::move(n)) {}
+  int value;
+  ChainLink next;
+  DestructionCounter counter;
+};
+
+struct TreeNode;
+using TreeLink = indirect_value<TreeNode, isocpp_p1950::default_copy<TreeNode>,
+                                isocpp_p1950::iterative_delete<TreeNode>>;
+
+struct TreeNode {
+  TreeLink left;
+  TreeLink right;
+  // A chain hanging off a tree node is queued with the tree nodes.
+  ChainLink chain;
+  DestructionCounter counter;
+};
+
+TreeLink make_full_tree(int depth) {
+  if (depth == 0) return TreeLink();
+  TreeLink node(std::in_place);
+  node->left = make_full_tree(depth - 1);
+  node->right = make_full_tree(depth - 1);
+  return node;
+}
+
+}  // namespace
+
+TEST_CASE("iterative_delete destroys long chains without recursion",
+          "[iterative_delete.chain]") {
+  constexpr int length = 1000000;
+
+  GIVEN("A chain of a million nodes") {
+    ChainLink head;
+    for (int i = 0; i != length; ++i) {
+      head = ChainLink(std::in_place, i, std::move(head));
+    }
+    REQUIRE(head->value == length - 1);
+    REQUIRE(head->next->value == length - 2);
+
+    WHEN("The head is reset") {
+      DestructionCounter::count = 0;
+      head.reset();
+      THEN("Every node is destroyed") {
+        REQUIRE(!head);
+        REQUIRE(DestructionCounter::count == length);
+      }
+    }
+  }
+}
+
+TEST_CASE("iterative_delete destroys deep and wide trees",
+          "[iterative_delete.tree]") {
+  GIVEN("A degenerate tree of a million nodes alternating left and right") {
+    constexpr int size = 1000000;
+    TreeLink root;
+    for (int i = 0; i != size; ++i) {
+      TreeLink parent(std::in_place);
+      (i % 2 ? parent->left : parent->right) = std::move(root);
+      root = std::move(parent);
+    }
+
+    THEN("Destroying it destroys every node") {
+      DestructionCounter::count = 0;
+      root.reset();
+      REQUIRE(DestructionCounter::count == size);
+    }
+  }
+
+  GIVEN("A full binary tree whose leaves own chains") {
+    constexpr int depth = 16;
+    constexpr int chain_length = 16;
+    TreeLink root = make_full_tree(depth);
+    constexpr std::size_t tree_size = (1u << depth) - 1;
+    constexpr std::size_t leaves = 1u << (depth - 1);
+
+    std::vector<TreeNode*> pending{&*root};
+    std::size_t leaves_seen = 0;
+    while (!pending.empty()) {
+      TreeNode* node = pending.back();
+      pending.pop_back();
+      if (node->left) pending.push_back(&*node->left);
+      if (node->right) pending.push_back(&*node->right);
+      if (!node->left && !node->right) {
+        ++leaves_seen;
+        for (int i = 0; i != chain_length; ++i) {
+          node->chain = ChainLink(std::in_place, i, std::move(node->chain));
+        }
+      }
+    }
+    REQUIRE(leaves_seen == leaves);
+
+    THEN("Destroying it destroys every tree and chain node") {
+      DestructionCounter::count = 0;
+      root.reset();
+      REQUIRE(DestructionCounter::count ==
+              tree_size + leaves * chain_length);
+    }
+  }
+}
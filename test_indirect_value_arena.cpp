@@ -0,0 +1,347 @@
+#include "indirect_value_arena.h"
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+using isocpp_p1950::arena;
+using isocpp_p1950::arena_indirect_value;
+using isocpp_p1950::compact;
+using isocpp_p1950::copy_range;
+using isocpp_p1950::indirect_value;
+using isocpp_p1950::make_arena_indirect_value;
+
+namespace {
+
+struct Live {
+  static inline long count = 0;
+  Live() { ++count; }
+  Live(const Live&) { ++count; }
+  Live& operator=(const Live&) = default;
+  ~Live() { --count; }
+};
+
+struct Node {
+  Node(int v, arena_indirect_value<Node> n) : value(v), next(std::move(n)) {}
+  int value;
+  arena_indirect_value<Node> next;
+  Live live;
+};
+
+// An empty arena_indirect_value, whose copies would be allocated from a.
+template <class T>
+arena_indirect_value<T> empty_in(arena& a) {
+  return arena_indirect_value<T>(static_cast<T*>(nullptr),
+                                 isocpp_p1950::arena_copy<T>(a),
+                                 isocpp_p1950::arena_delete<T>(a));
+}
+
+struct ThrowsOnMove {
+  static inline int moves_left = 0;
+  explicit ThrowsOnMove(int v) : value(v) {}
+  ThrowsOnMove(const ThrowsOnMove&) = default;
+  ThrowsOnMove(ThrowsOnMove&& other) : value(other.value) {
+    if (moves_left-- == 0) throw std::runtime_error("move");
+  }
+  int value;
+  Live live;
+};
+
+struct ThrowsOnCopy {
+  static inline int copies_left = 0;
+  explicit ThrowsOnCopy(int v) : value(v) {}
+  ThrowsOnCopy(const ThrowsOnCopy& other) : value(other.value) {
+    if (copies_left-- == 0) throw std::runtime_error("copy");
+  }
+  int value;
+  Live live;
+};
+
+// A copier which counts its calls.
+template <class T>
+struct CountingCopy {
+  static inline int calls = 0;
+  T* operator()(const T& t) const {
+    ++calls;
+    return new T(t);
+  }
+};
+
+struct alignas(64) OverAligned {
+  int value = 0;
+};
+
+}  // namespace
+
+TEST_CASE("arena_indirect_value is bound to an arena",
+          "[arena.construction]") {
+  STATIC_REQUIRE(!std::is_default_constructible_v<arena_indirect_value<int>>);
+  STATIC_REQUIRE(sizeof(arena_indirect_value<int>) == 3 * sizeof(void*));
+
+  arena a;
+  const auto v = make_arena_indirect_value<std::string>(a, 48, 'a');
+  REQUIRE(*v == std::string(48, 'a'));
+  REQUIRE(a.owns(&*v));
+}
+
+TEST_CASE("arena_copy and arena_delete are only used together",
+          "[arena.construction]") {
+  using isocpp_p1950::_pairs_with_v;
+  using isocpp_p1950::arena_copy;
+  using isocpp_p1950::arena_delete;
+  using isocpp_p1950::default_copy;
+
+  STATIC_REQUIRE(_pairs_with_v<arena_copy<int>, arena_delete<int>>);
+  STATIC_REQUIRE(!_pairs_with_v<arena_copy<int>, std::default_delete<int>>);
+  STATIC_REQUIRE(!_pairs_with_v<default_copy<int>, arena_delete<int>>);
+  STATIC_REQUIRE(!_pairs_with_v<arena_copy<int>, arena_delete<long>>);
+  STATIC_REQUIRE(_pairs_with_v<default_copy<int>, std::default_delete<int>>);
+}
+
+TEST_CASE("Copies are allocated from the arena of their source",
+          "[arena.copy]") {
+  arena a;
+  arena b;
+
+  GIVEN("An arena_indirect_value in one arena") {
+    const auto source = make_arena_indirect_value<int>(a, 42);
+
+    WHEN("It is copied") {
+      const auto copy = source;
+
+      THEN("The copy is in the same arena") {
+        REQUIRE(*copy == 42);
+        REQUIRE(&*copy != &*source);
+        REQUIRE(a.owns(&*copy));
+      }
+    }
+
+    WHEN("It is copy assigned to one in another arena") {
+      auto target = make_arena_indirect_value<int>(b, 0);
+      target = source;
+
+      THEN("The copy is in the arena of the source") {
+        REQUIRE(*target == 42);
+        REQUIRE(a.owns(&*target));
+        REQUIRE(!b.owns(&*target));
+      }
+    }
+
+    WHEN("A value is assigned or emplaced into a copy") {
+      auto copy = source;
+      copy = 7;
+      const int* assigned = &*copy;
+      copy.emplace(8);
+
+      THEN("The new owned objects are in the same arena") {
+        REQUIRE(*copy == 8);
+        REQUIRE(a.owns(assigned));
+        REQUIRE(a.owns(&*copy));
+        REQUIRE(!b.owns(&*copy));
+      }
+    }
+  }
+}
+
+TEST_CASE("Destroying arena_indirect_values runs only destructors",
+          "[arena.destruction]") {
+  constexpr int length = 10000;
+  arena a;
+  {
+    auto head = make_arena_indirect_value<Node>(a, 0, empty_in<Node>(a));
+    for (int i = 1; i != length; ++i) {
+      head = make_arena_indirect_value<Node>(a, i, std::move(head));
+    }
+    REQUIRE(Live::count == length);
+
+    const auto copy = head;
+    REQUIRE(Live::count == 2 * length);
+    int in_arena = 0;
+    for (const Node* n = &*copy; n; n = n->next.operator->()) {
+      if (a.owns(n)) ++in_arena;
+    }
+    REQUIRE(in_arena == length);
+  }
+  REQUIRE(Live::count == 0);
+  a.release();
+  REQUIRE(!a.owns(&a));
+}
+
+TEST_CASE("arena allocations are aligned", "[arena.align]") {
+  arena a;
+  for (int i = 0; i != 100; ++i) {
+    const auto v = make_arena_indirect_value<OverAligned>(a);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(&*v) % alignof(OverAligned) ==
+            0);
+    REQUIRE(a.owns(&*v));
+  }
+}
+
+TEST_CASE("An arena reuses no memory until released", "[arena.release]") {
+  arena a(64);
+  void* first = a.allocate(32, 8);
+  void* second = a.allocate(32, 8);
+  void* large = a.allocate(100000, 8);
+  REQUIRE(first != second);
+  REQUIRE(a.owns(first));
+  REQUIRE(a.owns(second));
+  REQUIRE(a.owns(static_cast<char*>(large) + 99999));
+  a.release();
+  REQUIRE(!a.owns(first));
+  REQUIRE(!a.owns(large));
+}
+
+TEST_CASE("compact lays out owned objects in the order of the range",
+          "[arena.compact]") {
+  constexpr int n = 1000;
+  arena fresh;
+  auto old = std::make_unique<arena>();
+
+  GIVEN("Owned objects allocated in a scattered order") {
+    std::vector<arena_indirect_value<std::string>> values(
+        n, empty_in<std::string>(*old));
+    for (int i = 0; i != n; ++i) {
+      const int j = int((i * 7919L) % n);
+      values[j] = make_arena_indirect_value<std::string>(
+          *old, std::to_string(j) + std::string(32, 'x'));
+    }
+    values[n / 2].reset();
+
+    WHEN("They are compacted into a fresh arena") {
+      compact(values, fresh);
+      old.reset();
+
+      THEN("They are contiguous, in order, with their values") {
+        const std::string* previous = nullptr;
+        for (int i = 0; i != n; ++i) {
+          if (i == n / 2) {
+            REQUIRE(!values[i]);
+            continue;
+          }
+          REQUIRE(*values[i] == std::to_string(i) + std::string(32, 'x'));
+          REQUIRE(fresh.owns(&*values[i]));
+          if (previous) REQUIRE(&*values[i] == previous + 1);
+          previous = &*values[i];
+        }
+      }
+
+      THEN("Copies and new objects are allocated from the fresh arena") {
+        const auto copy = values[0];
+        REQUIRE(fresh.owns(&*copy));
+        values[n / 2].emplace("new");
+        REQUIRE(fresh.owns(&*values[n / 2]));
+      }
+    }
+  }
+
+  GIVEN("A type whose move constructor throws") {
+    std::vector<arena_indirect_value<ThrowsOnMove>> values;
+    for (int i = 0; i != 4; ++i) {
+      values.push_back(make_arena_indirect_value<ThrowsOnMove>(*old, i));
+    }
+    REQUIRE(Live::count == 4);
+
+    WHEN("Compaction fails part way") {
+      ThrowsOnMove::moves_left = 2;
+      REQUIRE_THROWS_AS(compact(values, fresh), std::runtime_error);
+
+      THEN("The objects before the failure have been compacted") {
+        REQUIRE(Live::count == 4);
+        for (int i = 0; i != 4; ++i) REQUIRE(values[i]->value == i);
+        REQUIRE(fresh.owns(&*values[1]));
+        REQUIRE(old->owns(&*values[2]));
+      }
+      values.clear();
+    }
+  }
+  REQUIRE(Live::count == 0);
+}
+
+TEST_CASE("copy_range copies owned objects into one block, in order",
+          "[arena.copy_range]") {
+  constexpr int n = 1000;
+  arena a;
+
+  GIVEN("A vector of indirect_values on the free store") {
+    std::vector<indirect_value<std::string>> values;
+    for (int i = 0; i != n; ++i) {
+      values.emplace_back(std::in_place, std::to_string(i));
+    }
+    values[n / 2].reset();
+
+    WHEN("It is copied with copy_range") {
+      const auto copies = copy_range(values, a);
+
+      THEN("The copies are contiguous, in order, with equal values") {
+        REQUIRE(copies.size() == values.size());
+        const std::string* previous = nullptr;
+        for (int i = 0; i != n; ++i) {
+          REQUIRE(bool(copies[i]) == bool(values[i]));
+          if (!copies[i]) continue;
+          REQUIRE(*copies[i] == *values[i]);
+          REQUIRE(a.owns(&*copies[i]));
+          if (previous) REQUIRE(&*copies[i] == previous + 1);
+          previous = &*copies[i];
+        }
+      }
+
+      THEN("Copies of the copies are allocated from the arena") {
+        const auto copy = copies[0];
+        REQUIRE(a.owns(&*copy));
+      }
+    }
+
+    WHEN("It is copied to an output iterator") {
+      std::vector<arena_indirect_value<std::string>> copies(
+          n, empty_in<std::string>(a));
+      const auto end =
+          copy_range(values.begin(), values.end(), copies.begin(), a);
+
+      THEN("The copies are written to the output range") {
+        REQUIRE(end == copies.end());
+        REQUIRE(*copies[n - 1] == std::to_string(n - 1));
+        REQUIRE(!copies[n / 2]);
+      }
+    }
+  }
+
+  GIVEN("indirect_values with a copier of their own") {
+    std::vector<indirect_value<int, CountingCopy<int>>> values;
+    for (int i = 0; i != 4; ++i) values.emplace_back(std::in_place, i);
+
+    WHEN("They are copied with copy_range") {
+      const auto copies = copy_range(values, a);
+
+      THEN("The owned objects are copy constructed without the copier") {
+        REQUIRE(CountingCopy<int>::calls == 0);
+        REQUIRE(*copies[3] == 3);
+        REQUIRE(a.owns(&*copies[3]));
+      }
+    }
+  }
+
+  GIVEN("A type whose copy constructor throws") {
+    std::vector<indirect_value<ThrowsOnCopy>> values;
+    for (int i = 0; i != 4; ++i) values.emplace_back(std::in_place, i);
+
+    WHEN("Copying fails part way") {
+      std::vector<arena_indirect_value<ThrowsOnCopy>> copies;
+      ThrowsOnCopy::copies_left = 2;
+      REQUIRE_THROWS_AS(copy_range(values.begin(), values.end(),
+                                   std::back_inserter(copies), a),
+                        std::runtime_error);
+
+      THEN("Nothing is written and the copies made are destroyed") {
+        REQUIRE(copies.empty());
+        REQUIRE(Live::count == 4);
+      }
+    }
+  }
+  REQUIRE(Live::count == 0);
+}
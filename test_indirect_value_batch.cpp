@@ -0,0 +1,230 @@
+#include "indirect_value_batch.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+using isocpp_p1950::batched_indirect_value;
+
+namespace {
+
+struct Live {
+  static inline long count = 0;
+  Live() { ++count; }
+  Live(const Live&) { ++count; }
+  Live& operator=(const Live&) = default;
+  ~Live() { --count; }
+};
+
+struct ListNode {
+  ListNode(int v, batched_indirect_value<ListNode> n)
+      : value(v), next(std::move(n)) {}
+  int value;
+  batched_indirect_value<ListNode> next;
+  Live live;
+};
+
+batched_indirect_value<ListNode> make_list(int length) {
+  batched_indirect_value<ListNode> head;
+  for (int i = length; i != 0; --i) {
+    head = batched_indirect_value<ListNode>(std::in_place, i - 1,
+                                            std::move(head));
+  }
+  return head;
+}
+
+struct TreeNode {
+  int value = 0;
+  batched_indirect_value<TreeNode> left;
+  batched_indirect_value<TreeNode> right;
+};
+
+batched_indirect_value<TreeNode> make_tree(int depth, int& next_value) {
+  if (depth == 0) return {};
+  batched_indirect_value<TreeNode> node(std::in_place);
+  node->value = next_value++;
+  node->left = make_tree(depth - 1, next_value);
+  node->right = make_tree(depth - 1, next_value);
+  return node;
+}
+
+struct ThrowingNode {
+  static inline int copies_before_throw = 0;
+
+  ThrowingNode() = default;
+  ThrowingNode(const ThrowingNode& other)
+      : next(other.next), other(other.other) {
+    if (--copies_before_throw == 0) throw std::runtime_error("copy failed");
+  }
+
+  batched_indirect_value<ThrowingNode> next;
+  batched_indirect_value<ThrowingNode> other;
+  Live live;
+};
+
+// Copying drops the copy of next, whose construction is still pending.
+struct DroppingNode {
+  DroppingNode() = default;
+  DroppingNode(const DroppingNode& other)
+      : next(other.next), kept(other.kept) {
+    next.reset();
+  }
+
+  batched_indirect_value<DroppingNode> next;
+  batched_indirect_value<DroppingNode> kept;
+  Live live;
+};
+
+struct alignas(64) OverAligned {
+  batched_indirect_value<OverAligned> next;
+};
+
+}  // namespace
+
+TEST_CASE("Copying a long list with batched_copy",
+          "[batched_copy.list]") {
+  constexpr int length = 1000000;
+
+  GIVEN("A list of a million nodes") {
+    auto list = make_list(length);
+    REQUIRE(Live::count == length);
+
+    WHEN("It is copied") {
+      auto copy = list;
+
+      THEN("The copy is a deep copy of every node") {
+        REQUIRE(Live::count == 2 * length);
+        const ListNode* a = &*list;
+        const ListNode* b = &*copy;
+        int mismatches = 0;
+        for (int i = 0; i != length; ++i) {
+          if (a == b || b->value != i) ++mismatches;
+          a = a->next.operator->();
+          b = b->next.operator->();
+        }
+        REQUIRE(mismatches == 0);
+        REQUIRE(!a);
+        REQUIRE(!b);
+      }
+
+      THEN("The copied nodes are placed one after another") {
+        std::size_t adjacent = 0;
+        for (const ListNode* n = &*copy; n->next; n = &*n->next) {
+          const auto distance =
+              reinterpret_cast<std::uintptr_t>(&*n->next) -
+              reinterpret_cast<std::uintptr_t>(n);
+          if (distance < 2 * sizeof(ListNode)) ++adjacent;
+        }
+        REQUIRE(adjacent > static_cast<std::size_t>(length) * 99 / 100);
+      }
+
+      THEN("The blocks of the copy double in size") {
+        // The number of nodes placed at the same stride one after another,
+        // up to each change of block.
+        const ListNode* first = &*copy;
+        const auto stride = reinterpret_cast<std::uintptr_t>(&*first->next) -
+                            reinterpret_cast<std::uintptr_t>(first);
+        std::vector<std::size_t> runs(1, 1);
+        for (const ListNode* n = first; n->next && runs.size() != 4;
+             n = &*n->next) {
+          const auto distance =
+              reinterpret_cast<std::uintptr_t>(&*n->next) -
+              reinterpret_cast<std::uintptr_t>(n);
+          if (distance == stride) {
+            ++runs.back();
+          } else {
+            runs.push_back(1);
+          }
+        }
+        REQUIRE(runs.size() == 4);
+        REQUIRE(runs[1] > runs[0] * 3 / 2);
+        REQUIRE(runs[2] > runs[1] * 3 / 2);
+      }
+    }
+    list.reset();
+    REQUIRE(Live::count == 0);
+  }
+}
+
+TEST_CASE("Copying a tree with batched_copy", "[batched_copy.tree]") {
+  GIVEN("A full binary tree") {
+    int next_value = 0;
+    const auto tree = make_tree(14, next_value);
+
+    WHEN("It is copied") {
+      const auto copy = tree;
+
+      THEN("The copy has the same structure and values") {
+        std::vector<std::pair<const TreeNode*, const TreeNode*>> pending{
+            {&*tree, &*copy}};
+        int nodes = 0;
+        while (!pending.empty()) {
+          auto [a, b] = pending.back();
+          pending.pop_back();
+          ++nodes;
+          REQUIRE(a != b);
+          REQUIRE(a->value == b->value);
+          REQUIRE(bool(a->left) == bool(b->left));
+          REQUIRE(bool(a->right) == bool(b->right));
+          if (a->left) pending.emplace_back(&*a->left, &*b->left);
+          if (a->right) pending.emplace_back(&*a->right, &*b->right);
+        }
+        REQUIRE(nodes == next_value);
+      }
+    }
+  }
+}
+
+TEST_CASE("A throwing copy with batched_copy releases all copies",
+          "[batched_copy.exceptions]") {
+  batched_indirect_value<ThrowingNode> root(std::in_place);
+  root->other = batched_indirect_value<ThrowingNode>(std::in_place);
+  batched_indirect_value<ThrowingNode>* tail = &root;
+  for (int i = 0; i != 100; ++i) {
+    (*tail)->next = batched_indirect_value<ThrowingNode>(std::in_place);
+    (*tail)->next->other = batched_indirect_value<ThrowingNode>(std::in_place);
+    tail = &(*tail)->next;
+  }
+  const long live = Live::count;
+
+  for (int n : {1, 2, 3, 50, 150}) {
+    ThrowingNode::copies_before_throw = n;
+    REQUIRE_THROWS_AS(batched_indirect_value<ThrowingNode>(root),
+                      std::runtime_error);
+    REQUIRE(Live::count == live);
+  }
+
+  ThrowingNode::copies_before_throw = 1000;
+  auto copy = root;
+  REQUIRE(Live::count == 2 * live);
+}
+
+TEST_CASE("batched_copy tolerates copies which are dropped while pending",
+          "[batched_copy.abandoned]") {
+  batched_indirect_value<DroppingNode> root(std::in_place);
+  root->next = batched_indirect_value<DroppingNode>(std::in_place);
+  root->kept = batched_indirect_value<DroppingNode>(std::in_place);
+  root->kept->kept = batched_indirect_value<DroppingNode>(std::in_place);
+  const long live = Live::count;
+
+  {
+    auto copy = root;
+    REQUIRE(!copy->next);
+    REQUIRE(copy->kept);
+    REQUIRE(copy->kept->kept);
+    REQUIRE(Live::count == live + 3);
+  }
+  REQUIRE(Live::count == live);
+}
+
+TEST_CASE("batched_copy with over-aligned types", "[batched_copy.align]") {
+  batched_indirect_value<OverAligned> a(std::in_place);
+  a->next = batched_indirect_value<OverAligned>(std::in_place);
+  const auto b = a;
+  REQUIRE(reinterpret_cast<std::uintptr_t>(&*b) % alignof(OverAligned) == 0);
+  REQUIRE(reinterpret_cast<std::uintptr_t>(&*b->next) %
+              alignof(OverAligned) ==
+          0);
+}
@@ -0,0 +1,164 @@
+// Built as a program of its own, with
+// ISOCPP_P1950_INSTRUMENTATION=isocpp_p1950::counting_instrumentation, as
+// every translation unit of a program must use the same policy.
+
+#include "indirect_value_instrumentation.h"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "indirect_value.h"
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+using isocpp_p1950::counting_instrumentation;
+using isocpp_p1950::indirect_value;
+
+namespace {
+
+struct Counted {
+  int value = 0;
+  char padding[60] = {};
+};
+
+struct Peaked {
+  int value = 0;
+};
+
+struct Threaded {
+  long value = 0;
+};
+
+struct Reported {
+  int value = 0;
+};
+
+}  // namespace
+
+TEST_CASE("Operations are counted per type", "[instrumentation.counts]") {
+  // Sections run the test case more than once, so counts are compared with
+  // those at the start of each run.
+  const auto before = counting_instrumentation::statistics_of<Counted>();
+  const auto stats = [&before] {
+    auto s = counting_instrumentation::statistics_of<Counted>();
+    s.created -= before.created;
+    s.copies -= before.copies;
+    s.copy_assignments -= before.copy_assignments;
+    s.moves -= before.moves;
+    s.destroyed -= before.destroyed;
+    return s;
+  };
+  REQUIRE(before.live == 0);
+
+  GIVEN("Owned objects created in place and adopted") {
+    indirect_value<Counted> a(std::in_place);
+    indirect_value<Counted> b(new Counted);
+    REQUIRE(stats().created == 2);
+    REQUIRE(stats().live == 2);
+    REQUIRE(stats().live_bytes() == 2 * sizeof(Counted));
+
+    WHEN("They are copied, copy assigned and moved") {
+      indirect_value<Counted> c = a;
+      c = b;
+      indirect_value<Counted> d = std::move(c);
+
+      THEN("Deep copies, copy assignments, moves and bytes are counted") {
+        const auto s = stats();
+        REQUIRE(s.size == sizeof(Counted));
+        REQUIRE(s.created == 3);
+        REQUIRE(s.copies == 1);
+        REQUIRE(s.copy_assignments == 1);
+        REQUIRE(s.moves == 1);
+        REQUIRE(s.bytes_copied() == 2 * sizeof(Counted));
+        REQUIRE(s.live == 3);
+      }
+    }
+
+    WHEN("An owned object is replaced by emplace") {
+      a.emplace();
+
+      THEN("The old object is destroyed and a new one created") {
+        REQUIRE(stats().created == 3);
+        REQUIRE(stats().destroyed == 1);
+        REQUIRE(stats().live == 2);
+      }
+    }
+  }
+
+  GIVEN("Owned objects created by the factories") {
+    auto a = isocpp_p1950::make_indirect_value<Counted>();
+    auto b = isocpp_p1950::make_indirect_value_for_overwrite<Counted>();
+
+    THEN("Each is counted once as created") {
+      REQUIRE(stats().created == 2);
+      REQUIRE(stats().live == 2);
+      REQUIRE(stats().copies == 0);
+    }
+  }
+
+  THEN("Destroying the owners destroys every owned object") {
+    REQUIRE(stats().live == 0);
+    REQUIRE(stats().destroyed == stats().created);
+  }
+}
+
+TEST_CASE("The peak number of live objects is kept",
+          "[instrumentation.peak]") {
+  {
+    std::vector<indirect_value<Peaked>> values(100);
+    for (auto& v : values) v.emplace();
+    REQUIRE(counting_instrumentation::statistics_of<Peaked>().live == 100);
+  }
+  const auto s = counting_instrumentation::statistics_of<Peaked>();
+  REQUIRE(s.live == 0);
+  REQUIRE(s.peak == 100);
+}
+
+TEST_CASE("Counts of all threads are summed",
+          "[instrumentation.threads]") {
+  constexpr int threads = 4;
+  constexpr int per_thread = 1000;
+
+  std::vector<indirect_value<Threaded>> kept(threads);
+  std::vector<std::thread> workers;
+  for (int t = 0; t != threads; ++t) {
+    workers.emplace_back([&kept, t] {
+      indirect_value<Threaded> last;
+      for (int i = 0; i != per_thread; ++i) {
+        indirect_value<Threaded> v(std::in_place);
+        last = v;
+      }
+      kept[t] = std::move(last);
+    });
+  }
+  for (auto& w : workers) w.join();
+
+  const auto s = counting_instrumentation::statistics_of<Threaded>();
+  // The first copy of each thread is a deep copy, and the rest are copy
+  // assigned in place.
+  REQUIRE(s.created == threads * (per_thread + 1));
+  REQUIRE(s.copies == threads);
+  REQUIRE(s.copy_assignments == threads * (per_thread - 1));
+  REQUIRE(s.moves == threads);
+  REQUIRE(s.live == threads);
+  REQUIRE(s.peak >= threads);
+}
+
+TEST_CASE("The report lists every type", "[instrumentation.report]") {
+  indirect_value<Reported> a(std::in_place);
+  indirect_value<Reported> b = a;
+
+  std::FILE* out = std::tmpfile();
+  REQUIRE(out);
+  counting_instrumentation::report(out);
+  std::rewind(out);
+  std::string text;
+  for (int c; (c = std::fgetc(out)) != EOF;) text.push_back(char(c));
+  std::fclose(out);
+
+  REQUIRE(text.find("bytes copied") != std::string::npos);
+  REQUIRE(text.find("Reported") != std::string::npos);
+}
@@ -0,0 +1,123 @@
+// Built as a program of its own, with
+// ISOCPP_P1950_INSTRUMENTATION=isocpp_p1950::lifetime_instrumentation, as
+// every translation unit of a program must use the same policy. Lifetimes
+// are recorded per type for the whole program, so each test case uses types
+// of its own.
+
+#include "indirect_value_instrumentation.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "indirect_value.h"
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+using isocpp_p1950::indirect_value;
+using isocpp_p1950::lifetime_class;
+using isocpp_p1950::lifetime_instrumentation;
+using isocpp_p1950::lifetime_statistics;
+
+namespace {
+
+struct ShortLived {
+  int value = 0;
+};
+
+struct LongLived {
+  int value = 0;
+};
+
+struct Sited {
+  int value = 0;
+};
+
+struct Suggested {
+  int value = 0;
+};
+
+lifetime_statistics lifetimes_of(const std::string& type_name) {
+  for (auto& s : lifetime_instrumentation::statistics()) {
+    if (s.type_name.find(type_name) != std::string::npos) return s;
+  }
+  return {};
+}
+
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+indirect_value<Sited> make_sited() {
+  return indirect_value<Sited>(std::in_place);
+}
+
+}  // namespace
+
+TEST_CASE("Lifetimes of objects destroyed soon are short",
+          "[instrumentation.lifetime.short]") {
+  for (int i = 0; i != 1000; ++i) {
+    indirect_value<ShortLived> a(std::in_place);
+    indirect_value<ShortLived> b = a;
+  }
+  const auto s = lifetimes_of("ShortLived");
+  REQUIRE(s.ended == 2000);
+  REQUIRE(s.live == 0);
+  REQUIRE(s.count() == 2000);
+  REQUIRE(s.quantile_ns(0.5) <= s.quantile_ns(0.9));
+  REQUIRE(s.classify() == lifetime_class::short_lived);
+}
+
+TEST_CASE("Objects which are still live count with their ages",
+          "[instrumentation.lifetime.long]") {
+  std::vector<indirect_value<LongLived>> values(10);
+  for (auto& v : values) v.emplace();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  const auto s = lifetimes_of("LongLived");
+  REQUIRE(s.live == 10);
+  REQUIRE(s.quantile_ns(0.5) >= 20 * 1000 * 1000);
+  REQUIRE(s.classify(1000 * 1000, 10 * 1000 * 1000) ==
+          lifetime_class::long_lived);
+  REQUIRE(s.classify() == lifetime_class::mixed);
+}
+
+#ifdef ISOCPP_P1950_HAS_EXECINFO
+TEST_CASE("Call sites are recorded on request",
+          "[instrumentation.lifetime.sites]") {
+  lifetime_instrumentation::record_call_sites(true);
+  for (int i = 0; i != 3; ++i) make_sited();
+  lifetime_instrumentation::record_call_sites(false);
+  make_sited();
+
+  std::uint64_t created = 0;
+  for (const auto& site : lifetime_instrumentation::sites()) {
+    if (site.type_name.find("Sited") == std::string::npos) continue;
+    REQUIRE(!site.frames.empty());
+    created += site.created;
+    REQUIRE(site.ended == site.created);
+  }
+  REQUIRE(created == 3);
+  REQUIRE(lifetimes_of("Sited").ended == 4);
+}
+#endif
+
+TEST_CASE("The lifetime report suggests allocation policies",
+          "[instrumentation.lifetime.report]") {
+  for (int i = 0; i != 10; ++i) indirect_value<Suggested> a(std::in_place);
+
+  std::FILE* out = std::tmpfile();
+  REQUIRE(out);
+  lifetime_instrumentation::report(out);
+  std::rewind(out);
+  std::string text;
+  for (int c; (c = std::fgetc(out)) != EOF;) text.push_back(char(c));
+  std::fclose(out);
+
+  REQUIRE(text.find("Suggested") != std::string::npos);
+  REQUIRE(text.find("consider arena or monotonic allocation") !=
+          std::string::npos);
+}
@@ -0,0 +1,108 @@
+#include "indirect_value_pool.h"
+
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+using isocpp_p1950::pooled_indirect_value;
+
+namespace {
+
+struct Large {
+  std::array<char, 1024> data{};
+};
+
+}  // namespace
+
+TEST_CASE("pooled_indirect_value uses the minimum space requirements",
+          "[pool.sizeof]") {
+  REQUIRE(sizeof(pooled_indirect_value<int>) == sizeof(int*));
+  REQUIRE(isocpp_p1950::is_trivially_relocatable_v<
+          pooled_indirect_value<std::string>>);
+}
+
+TEST_CASE("pooled_indirect_value has value semantics", "[pool.semantics]") {
+  GIVEN("A pooled_indirect_value") {
+    pooled_indirect_value<std::string> a(std::in_place, "pooled");
+
+    THEN("Copies are deep copies") {
+      pooled_indirect_value<std::string> b(a);
+      REQUIRE(*b == "pooled");
+      REQUIRE(&*a != &*b);
+      *b = "changed";
+      REQUIRE(*a == "pooled");
+    }
+
+    THEN("Large objects are supported") {
+      pooled_indirect_value<Large> large(std::in_place);
+      large->data[1023] = 'x';
+      pooled_indirect_value<Large> copy(large);
+      REQUIRE(copy->data[1023] == 'x');
+    }
+  }
+}
+
+TEST_CASE("Freed blocks are reused by the same thread", "[pool.reuse]") {
+  const void* location = nullptr;
+  {
+    pooled_indirect_value<int> a(std::in_place, 1);
+    location = &*a;
+  }
+  pooled_indirect_value<int> b(std::in_place, 2);
+  REQUIRE(&*b == location);
+
+  GIVEN("Types of a different size class") {
+    pooled_indirect_value<std::array<char, 100>> c(std::in_place);
+    THEN("They do not share blocks") { REQUIRE(c.operator->() != location); }
+  }
+}
+
+TEST_CASE("Blocks freed by another thread return to their owning pool",
+          "[pool.remote]") {
+  // The pool of a thread which exits is adopted by the next thread which
+  // needs a pool, together with blocks freed remotely in the meantime.
+  pooled_indirect_value<std::array<char, 200>> value;
+  std::thread([&value] { value.emplace(); }).join();
+  const void* location = value.operator->();
+  value.reset();
+
+  const void* reused = nullptr;
+  std::thread([&reused] {
+    pooled_indirect_value<std::array<char, 200>> v(std::in_place);
+    reused = v.operator->();
+  }).join();
+  REQUIRE(reused == location);
+}
+
+TEST_CASE("Concurrent copies and cross-thread frees", "[pool.concurrency]") {
+  constexpr int threads = 4;
+  constexpr int count = 10000;
+  std::vector<std::vector<pooled_indirect_value<int>>> produced(threads);
+  std::vector<std::thread> workers;
+  for (int t = 0; t != threads; ++t) {
+    workers.emplace_back([t, &produced] {
+      pooled_indirect_value<int> prototype(std::in_place, t);
+      for (int i = 0; i != count; ++i) produced[t].push_back(prototype);
+    });
+  }
+  for (auto& w : workers) w.join();
+  workers.clear();
+
+  // Free every thread's values on another thread. Catch2 assertions are not
+  // thread-safe, so the workers only record what they find.
+  std::vector<int> mismatches(threads);
+  for (int t = 0; t != threads; ++t) {
+    workers.emplace_back([t, &produced, &mismatches] {
+      const int producer = (t + 1) % threads;
+      for (const auto& v : produced[producer]) {
+        if (*v != producer) ++mismatches[t];
+      }
+      produced[producer].clear();
+    });
+  }
+  for (auto& w : workers) w.join();
+  for (int m : mismatches) REQUIRE(m == 0);
+}
@@ -0,0 +1,98 @@
+#include "indirect_value_prefetch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <list>
+#include <numeric>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+using isocpp_p1950::indirect_value;
+using isocpp_p1950::prefetch;
+using isocpp_p1950::prefetch_for_write;
+namespace views = isocpp_p1950::views;
+
+namespace {
+
+std::vector<indirect_value<int>> make_values(int n) {
+  std::vector<indirect_value<int>> values;
+  for (int i = 0; i != n; ++i) values.emplace_back(std::in_place, i);
+  return values;
+}
+
+}  // namespace
+
+TEST_CASE("prefetch accepts empty and full indirect_values",
+          "[prefetch.prefetch]") {
+  indirect_value<std::string> empty;
+  indirect_value<std::string> full(std::in_place, "full");
+  prefetch(empty);
+  prefetch(full);
+  prefetch_for_write(empty);
+  prefetch_for_write(full);
+  REQUIRE(!empty);
+  REQUIRE(*full == "full");
+}
+
+TEST_CASE("views::indirect_prefetch visits the owned objects in order",
+          "[prefetch.view]") {
+  constexpr int n = 1000;
+  auto values = make_values(n);
+
+  GIVEN("A prefetch distance") {
+    const auto distance = GENERATE(as<std::size_t>{}, 0, 1, 8, 1000, 2000);
+
+    THEN("Every owned object is visited once, in order") {
+      int expected = 0;
+      for (int& i : values | views::indirect_prefetch(distance)) {
+        REQUIRE(i == expected++);
+      }
+      REQUIRE(expected == n);
+    }
+  }
+
+  GIVEN("The default prefetch distance") {
+    const auto view = views::indirect_prefetch(values);
+    THEN("Standard algorithms work on the view") {
+      REQUIRE(std::accumulate(view.begin(), view.end(), 0) == n * (n - 1) / 2);
+      REQUIRE(*std::find(view.begin(), view.end(), 500) == 500);
+      REQUIRE(std::distance(view.begin(), view.end()) == n);
+    }
+  }
+
+  GIVEN("A mutable range") {
+    THEN("Owned objects may be modified through the view") {
+      for (int& i : values | views::indirect_prefetch()) i = -i;
+      REQUIRE(*values[n - 1] == -(n - 1));
+    }
+  }
+
+  GIVEN("A const range") {
+    const auto& const_values = values;
+    THEN("Constness propagates to the owned objects") {
+      using view = decltype(const_values | views::indirect_prefetch(4));
+      STATIC_REQUIRE(
+          std::is_same_v<decltype(*std::declval<view>().begin()), const int&>);
+    }
+  }
+
+  GIVEN("An empty range") {
+    std::vector<indirect_value<int>> none;
+    auto view = none | views::indirect_prefetch(4);
+    THEN("The view is empty") { REQUIRE(view.begin() == view.end()); }
+  }
+}
+
+TEST_CASE("views::indirect_prefetch works on forward ranges",
+          "[prefetch.forward]") {
+  std::list<indirect_value<std::string>> values;
+  for (int i = 0; i != 10; ++i) {
+    values.emplace_back(std::in_place, std::to_string(i));
+  }
+  std::string joined;
+  for (const auto& s : values | views::indirect_prefetch(3)) joined += s;
+  REQUIRE(joined == "0123456789");
+}
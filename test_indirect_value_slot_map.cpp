@@ -0,0 +1,154 @@
+#include "indirect_value_slot_map.h"
+
+#include <array>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+using isocpp_p1950::slot_map;
+using isocpp_p1950::slot_map_indirect_value;
+
+namespace {
+
+// Each test uses types of its own, so that it sees only the objects of its
+// own slot maps.
+struct Record {
+  int id = 0;
+  std::string name;
+};
+
+struct Counted {
+  int value = 0;
+};
+
+// Fills its slot, which is at least the size of a pointer.
+struct Fresh {
+  void* value = nullptr;
+};
+
+struct Concurrent {
+  int value = 0;
+};
+
+struct Large {
+  std::array<char, 100000> data{};
+};
+
+}  // namespace
+
+TEST_CASE("slot_map_indirect_value uses the minimum space requirements",
+          "[slot_map.sizeof]") {
+  STATIC_REQUIRE(sizeof(slot_map_indirect_value<int>) == sizeof(int*));
+  STATIC_REQUIRE(isocpp_p1950::is_trivially_relocatable_v<
+                 slot_map_indirect_value<std::string>>);
+}
+
+TEST_CASE("slot_map_indirect_value has value semantics",
+          "[slot_map.semantics]") {
+  GIVEN("A slot_map_indirect_value") {
+    slot_map_indirect_value<Record> a(std::in_place, Record{1, "one"});
+    REQUIRE(slot_map<Record>::owns(&*a));
+
+    THEN("Copies are deep copies in the slot map") {
+      slot_map_indirect_value<Record> b(a);
+      REQUIRE(b->name == "one");
+      REQUIRE(&*a != &*b);
+      REQUIRE(slot_map<Record>::owns(&*b));
+      b->name = "changed";
+      REQUIRE(a->name == "one");
+    }
+
+    THEN("Constness propagates to the owned object") {
+      const auto& c = a;
+      STATIC_REQUIRE(std::is_same_v<decltype(*c), const Record&>);
+    }
+
+    THEN("Large objects are supported") {
+      slot_map_indirect_value<Large> large(std::in_place);
+      large->data[99999] = 'x';
+      slot_map_indirect_value<Large> copy(large);
+      REQUIRE(copy->data[99999] == 'x');
+      REQUIRE(slot_map<Large>::owns(&copy->data[99999]));
+    }
+  }
+  REQUIRE(slot_map<Record>::size() == 0);
+}
+
+TEST_CASE("for_each visits every owned object once", "[slot_map.for_each]") {
+  constexpr int count = 20000;
+  std::vector<slot_map_indirect_value<Counted>> values;
+  for (int i = 0; i != count; ++i) {
+    values.emplace_back(std::in_place, Counted{i});
+  }
+
+  GIVEN("Some of the owned objects destroyed") {
+    for (int i = 0; i < count; i += 2) values[i].reset();
+
+    THEN("Only the others are visited") {
+      REQUIRE(slot_map<Counted>::size() == count / 2);
+      long long sum = 0;
+      int visited = 0;
+      slot_map<Counted>::for_each([&](Counted& c) {
+        sum += c.value;
+        ++visited;
+      });
+      REQUIRE(visited == count / 2);
+      REQUIRE(sum == (long long)(count / 2) * (count / 2));
+    }
+
+    THEN("Their slots are reused before new slots") {
+      const Counted* freed = nullptr;
+      {
+        slot_map_indirect_value<Counted> v(std::in_place);
+        freed = &*v;
+      }
+      slot_map_indirect_value<Counted> w(std::in_place);
+      REQUIRE(&*w == freed);
+    }
+
+    THEN("Objects may be modified in place") {
+      slot_map<Counted>::for_each([](Counted& c) { c.value = -c.value; });
+      REQUIRE(values[1]->value == -1);
+      REQUIRE(values[count - 1]->value == -(count - 1));
+    }
+  }
+}
+
+TEST_CASE("Objects of a new slot map are allocated contiguously",
+          "[slot_map.layout]") {
+  std::vector<slot_map_indirect_value<Fresh>> values;
+  for (int i = 0; i != 100; ++i) values.emplace_back(std::in_place);
+  for (int i = 1; i != 100; ++i) REQUIRE(&*values[i] == &*values[i - 1] + 1);
+}
+
+TEST_CASE("Objects are allocated and freed concurrently",
+          "[slot_map.concurrency]") {
+  constexpr int threads = 4;
+  constexpr int per_thread = 10000;
+  std::vector<std::vector<slot_map_indirect_value<Concurrent>>> produced(
+      threads);
+  std::vector<std::thread> workers;
+  for (int t = 0; t != threads; ++t) {
+    workers.emplace_back([t, &produced] {
+      for (int i = 0; i != per_thread; ++i) {
+        produced[t].emplace_back(std::in_place, Concurrent{i});
+        if (i % 3 == 0) produced[t].pop_back();
+      }
+    });
+  }
+  for (auto& w : workers) w.join();
+
+  std::size_t live = 0;
+  for (const auto& p : produced) live += p.size();
+  REQUIRE(slot_map<Concurrent>::size() == live);
+
+  int visited = 0;
+  slot_map<Concurrent>::for_each([&](const Concurrent&) { ++visited; });
+  REQUIRE(visited == int(live));
+
+  produced.clear();
+  REQUIRE(slot_map<Concurrent>::size() == 0);
+}
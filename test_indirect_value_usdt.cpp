@@ -0,0 +1,445 @@
+// Built as a program of its own, with ISOCPP_P1950_USDT defined, when
+// <sys/sdt.h> is available. The probes are found in the notes of the
+// executable. On x86-64 they are made to fire as a tracer would, by
+// replacing their nops with breakpoints, and their arguments are read as
+// their notes describe. Where text pages cannot be made writable, that test
+// is skipped, and so is the check of any argument whose operand it cannot
+// read.
+
+#include <elf.h>
+#include <link.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "indirect_value.h"
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+using isocpp_p1950::indirect_value;
+
+namespace {
+
+struct Traced {
+  int value = 0;
+};
+
+struct probe {
+  std::string provider;
+  std::string name;
+  std::string arguments;
+  std::uintptr_t location;
+};
+
+const std::string& executable_image() {
+  static const std::string image = [] {
+    std::ifstream file("/proc/self/exe", std::ios::binary);
+    return std::string{std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>()};
+  }();
+  return image;
+}
+
+std::vector<probe> probes_of_executable() {
+  const char* data = executable_image().data();
+  const auto* header = reinterpret_cast<const Elf64_Ehdr*>(data);
+  const auto* sections =
+      reinterpret_cast<const Elf64_Shdr*>(data + header->e_shoff);
+  const char* section_names = data + sections[header->e_shstrndx].sh_offset;
+
+  std::vector<probe> probes;
+  for (int i = 0; i != header->e_shnum; ++i) {
+    if (std::strcmp(section_names + sections[i].sh_name, ".note.stapsdt")) {
+      continue;
+    }
+    const char* note = data + sections[i].sh_offset;
+    const char* end = note + sections[i].sh_size;
+    const auto align4 = [](std::size_t n) {
+      return (n + 3) & ~std::size_t(3);
+    };
+    while (note < end) {
+      const auto* n = reinterpret_cast<const Elf64_Nhdr*>(note);
+      const char* desc = note + sizeof(Elf64_Nhdr) + align4(n->n_namesz);
+      if (n->n_type == 3 &&
+          !std::strcmp(note + sizeof(Elf64_Nhdr), "stapsdt")) {
+        probe p;
+        std::memcpy(&p.location, desc, sizeof(p.location));
+        const char* strings = desc + 3 * sizeof(std::uint64_t);
+        p.provider = strings;
+        p.name = strings + p.provider.size() + 1;
+        p.arguments = strings + p.provider.size() + p.name.size() + 2;
+        probes.push_back(p);
+      }
+      note = desc + align4(n->n_descsz);
+    }
+  }
+  return probes;
+}
+
+std::vector<probe> indirect_value_probes() {
+  std::vector<probe> probes;
+  for (const probe& p : probes_of_executable()) {
+    if (p.provider == "isocpp_p1950") probes.push_back(p);
+  }
+  return probes;
+}
+
+bool has_probe(const std::vector<probe>& probes, const std::string& name) {
+  for (const probe& p : probes) {
+    if (p.name == name) return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+TEST_CASE("The probes are placed in the executable", "[usdt.notes]") {
+  const auto probes = indirect_value_probes();
+  REQUIRE(has_probe(probes, "allocate"));
+  REQUIRE(has_probe(probes, "copy"));
+  REQUIRE(has_probe(probes, "destroy"));
+  for (const probe& p : probes) {
+    // Three arguments, separated by spaces.
+    REQUIRE(std::count(p.arguments.begin(), p.arguments.end(), '@') == 3);
+  }
+}
+
+#if defined(__x86_64__)
+
+namespace {
+
+// The link-time address of the symbol name in the executable, or 0.
+std::uintptr_t symbol_value(const std::string& name) {
+  const char* data = executable_image().data();
+  const auto* header = reinterpret_cast<const Elf64_Ehdr*>(data);
+  const auto* sections =
+      reinterpret_cast<const Elf64_Shdr*>(data + header->e_shoff);
+  for (int i = 0; i != header->e_shnum; ++i) {
+    if (sections[i].sh_type != SHT_SYMTAB) continue;
+    const char* names = data + sections[sections[i].sh_link].sh_offset;
+    const auto* symbols =
+        reinterpret_cast<const Elf64_Sym*>(data + sections[i].sh_offset);
+    const std::size_t count = sections[i].sh_size / sizeof(Elf64_Sym);
+    for (std::size_t j = 0; j != count; ++j) {
+      if (name == names + symbols[j].st_name) return symbols[j].st_value;
+    }
+  }
+  return 0;
+}
+
+// A probe argument as described in its note: [-]<size>@<operand>, where the
+// operand is an immediate ($42), a register of any width (%rdi, %edi, %di,
+// %dil), a register-relative memory location (-24(%rbp)), or a variable
+// addressed relative to %rip (symbol+8(%rip)), which tracers look up by
+// name as done here.
+struct argument {
+  enum { immediate, reg, memory, absolute, unknown } kind = unknown;
+  std::uint64_t value = 0;  // The immediate value, or absolute address.
+  int greg = 0;             // The register, as an index into gregs.
+  unsigned shift = 0;       // 8 for the high byte registers, as %ah.
+  long displacement = 0;    // The displacement of a memory location.
+  unsigned size = 8;
+  std::string spec;
+};
+
+// Sets the register of a to the one named, or returns false.
+bool parse_register(const std::string& name, argument& a) {
+  static const std::pair<const char*, int> registers[] = {
+      {"ax", REG_RAX}, {"bx", REG_RBX}, {"cx", REG_RCX}, {"dx", REG_RDX},
+      {"si", REG_RSI}, {"di", REG_RDI}, {"bp", REG_RBP}, {"sp", REG_RSP}};
+  static const std::pair<const char*, int> numbered[] = {
+      {"r8", REG_R8},   {"r9", REG_R9},   {"r10", REG_R10}, {"r11", REG_R11},
+      {"r12", REG_R12}, {"r13", REG_R13}, {"r14", REG_R14}, {"r15", REG_R15}};
+  a.shift = 0;
+  for (const auto& [n, index] : registers) {
+    const std::string r = n;
+    // %ax, %bx, %cx and %dx have the byte registers %al and %ah; the others
+    // have %sil, %dil, %bpl and %spl.
+    const std::string low = r[1] == 'x' ? r.substr(0, 1) + "l" : r + "l";
+    a.greg = index;
+    if (name == "r" + r || name == "e" + r || name == r || name == low) {
+      return true;
+    }
+    if (r[1] == 'x' && name == r.substr(0, 1) + "h") {
+      a.shift = 8;
+      return true;
+    }
+  }
+  for (const auto& [n, index] : numbered) {
+    const std::string r = n;
+    a.greg = index;
+    if (name == r || name == r + "d" || name == r + "w" || name == r + "b") {
+      return true;
+    }
+  }
+  return false;
+}
+
+argument parse_argument(const std::string& spec, std::uintptr_t bias) {
+  argument a;
+  a.spec = spec;
+  const std::size_t at = spec.find('@');
+  if (at == std::string::npos) return a;
+  const std::string operand = spec.substr(at + 1);
+  try {
+    a.size = unsigned(std::abs(std::stoi(spec.substr(0, at))));
+    if (operand[0] == '$') {
+      a.kind = argument::immediate;
+      a.value = std::uint64_t(std::stoll(operand.substr(1), nullptr, 0));
+    } else if (operand[0] == '%') {
+      if (parse_register(operand.substr(1), a)) a.kind = argument::reg;
+    } else if (const std::size_t paren = operand.find("(%");
+               paren != std::string::npos && operand.back() == ')') {
+      const std::string base =
+          operand.substr(paren + 2, operand.size() - paren - 3);
+      const std::string offset = operand.substr(0, paren);
+      if (base == "rip") {
+        // symbol, symbol+8 or symbol-8.
+        const std::size_t sign = offset.find_first_of("+-", 1);
+        const std::uintptr_t symbol = symbol_value(offset.substr(0, sign));
+        const long addend =
+            sign == std::string::npos ? 0 : std::stol(offset.substr(sign));
+        if (symbol) {
+          a.kind = argument::absolute;
+          a.value = bias + symbol + std::uintptr_t(addend);
+        }
+      } else if (parse_register(base, a)) {
+        a.displacement = offset.empty() ? 0 : std::stol(offset, nullptr, 0);
+        a.kind = argument::memory;
+      }
+    }
+  } catch (const std::logic_error&) {
+    a.kind = argument::unknown;
+  }
+  return a;
+}
+
+std::vector<argument> parse_arguments(const std::string& arguments,
+                                      std::uintptr_t bias) {
+  std::vector<argument> parsed;
+  std::size_t begin = 0;
+  while (begin < arguments.size()) {
+    std::size_t end = arguments.find(' ', begin);
+    if (end == std::string::npos) end = arguments.size();
+    const std::string spec = arguments.substr(begin, end - begin);
+    begin = end + 1;
+    if (!spec.empty()) parsed.push_back(parse_argument(spec, bias));
+  }
+  return parsed;
+}
+
+struct armed_probe {
+  std::uintptr_t address;
+  const probe* p;
+  std::vector<argument> arguments;
+};
+
+struct fired_probe {
+  const probe* p;
+  const std::vector<argument>* specs;
+  bool read[3];
+  std::uint64_t arguments[3];
+};
+
+std::vector<armed_probe> armed;
+// Written by the signal handler, so without allocating.
+fired_probe fired[16];
+std::size_t fired_count = 0;
+
+bool read_argument(const argument& a, const mcontext_t& context,
+                   std::uint64_t& value) {
+  switch (a.kind) {
+    case argument::immediate:
+      value = a.value;
+      break;
+    case argument::reg:
+      value = std::uint64_t(context.gregs[a.greg]) >> a.shift;
+      break;
+    case argument::memory:
+      std::memcpy(&value,
+                  reinterpret_cast<const void*>(context.gregs[a.greg] +
+                                                a.displacement),
+                  sizeof(value));
+      break;
+    case argument::absolute:
+      std::memcpy(&value, reinterpret_cast<const void*>(a.value),
+                  sizeof(value));
+      break;
+    case argument::unknown:
+      return false;
+  }
+  if (a.size < sizeof(value)) value &= (std::uint64_t(1) << 8 * a.size) - 1;
+  return true;
+}
+
+void on_breakpoint(int, siginfo_t*, void* context) {
+  const mcontext_t& mcontext = static_cast<ucontext_t*>(context)->uc_mcontext;
+  // The breakpoint replaces a one byte nop, so execution continues after it.
+  const auto address = static_cast<std::uintptr_t>(mcontext.gregs[REG_RIP]) - 1;
+  for (const armed_probe& a : armed) {
+    if (a.address != address || fired_count == std::size(fired)) continue;
+    fired_probe& f = fired[fired_count++];
+    f.p = a.p;
+    f.specs = &a.arguments;
+    for (std::size_t i = 0; i != std::size(f.arguments); ++i) {
+      f.read[i] = i < a.arguments.size() &&
+                  read_argument(a.arguments[i], mcontext, f.arguments[i]);
+    }
+  }
+}
+
+int add_load_bias(dl_phdr_info* info, std::size_t, void* bias) {
+  *static_cast<std::uintptr_t*>(bias) = info->dlpi_addr;
+  return 1;  // The executable comes first.
+}
+
+// Writes byte to the text page at address, or returns false if the page
+// cannot be made writable, as under a W^X policy.
+bool patch(std::uintptr_t address, unsigned char byte) {
+  const auto page_size = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+  void* page = reinterpret_cast<void*>(address & ~(page_size - 1));
+  if (mprotect(page, page_size, PROT_READ | PROT_WRITE | PROT_EXEC) != 0) {
+    return false;
+  }
+  *reinterpret_cast<volatile unsigned char*>(address) = byte;
+  return mprotect(page, page_size, PROT_READ | PROT_EXEC) == 0;
+}
+
+}  // namespace
+
+TEST_CASE("The probes fire with their arguments", "[usdt.fire]") {
+  const auto probes = indirect_value_probes();
+  std::uintptr_t bias = 0;
+  dl_iterate_phdr(&add_load_bias, &bias);
+
+  for (const probe& p : probes) {
+    const std::uintptr_t address = bias + p.location;
+    REQUIRE(*reinterpret_cast<const unsigned char*>(address) == 0x90);
+    armed.push_back({address, &p, parse_arguments(p.arguments, bias)});
+  }
+  for (std::size_t i = 0; i != armed.size(); ++i) {
+    if (!patch(armed[i].address, 0xcc)) {
+      while (i) patch(armed[--i].address, 0x90);
+      armed.clear();
+      WARN("Skipped: text pages cannot be made writable to arm the probes");
+      return;
+    }
+  }
+
+  struct sigaction action = {};
+  action.sa_sigaction = &on_breakpoint;
+  action.sa_flags = SA_SIGINFO;
+  struct sigaction previous;
+  REQUIRE(sigaction(SIGTRAP, &action, &previous) == 0);
+
+  const void* original = nullptr;
+  const void* copy = nullptr;
+  const void* overwritten = nullptr;
+  {
+    indirect_value<Traced> a(std::in_place);
+    indirect_value<Traced> b = a;
+    auto c = isocpp_p1950::make_indirect_value_for_overwrite<Traced>();
+    original = a.operator->();
+    copy = b.operator->();
+    overwritten = c.operator->();
+  }
+
+  for (const armed_probe& a : armed) REQUIRE(patch(a.address, 0x90));
+  sigaction(SIGTRAP, &previous, nullptr);
+
+  struct expected_probe {
+    std::string name;
+    const void* object;
+  };
+  const std::vector<expected_probe> expected = {{"allocate", original},
+                                                {"copy", copy},
+                                                {"allocate", overwritten},
+                                                {"destroy", overwritten},
+                                                {"destroy", copy},
+                                                {"destroy", original}};
+  REQUIRE(fired_count == expected.size());
+  for (std::size_t i = 0; i != fired_count; ++i) {
+    const fired_probe& f = fired[i];
+    REQUIRE(f.p->name == expected[i].name);
+    REQUIRE(f.specs->size() == std::size(f.arguments));
+    const std::uint64_t values[] = {
+        isocpp_p1950::type_name_hash<Traced>, sizeof(Traced),
+        reinterpret_cast<std::uintptr_t>(expected[i].object)};
+    for (std::size_t j = 0; j != std::size(values); ++j) {
+      // Operands this test cannot read are left to the tracers.
+      if (!f.read[j]) {
+        WARN("Skipped argument " << j << " of " << f.p->name
+                                 << ": cannot read " << (*f.specs)[j].spec);
+        continue;
+      }
+      REQUIRE(f.arguments[j] == values[j]);
+    }
+  }
+  armed.clear();
+}
+
+TEST_CASE("Probe arguments are parsed as tracers do", "[usdt.arguments]") {
+  const auto kind_of = [](const std::string& spec) {
+    return parse_argument(spec, 0).kind;
+  };
+  REQUIRE(kind_of("8@$42") == argument::immediate);
+  REQUIRE(parse_argument("-8@$-3", 0).value == std::uint64_t(-3));
+  REQUIRE(parse_argument("-8@$-3", 0).size == 8);
+
+  for (const char* name :
+       {"rax", "eax", "ax", "al", "rdi", "edi", "di", "dil", "r8", "r8d",
+        "r8w", "r8b", "r15", "r15d"}) {
+    const argument a = parse_argument(std::string("4@%") + name, 0);
+    REQUIRE(a.kind == argument::reg);
+    REQUIRE(a.shift == 0);
+    REQUIRE(a.size == 4);
+  }
+  REQUIRE(parse_argument("8@%edi", 0).greg == REG_RDI);
+  REQUIRE(parse_argument("2@%r9w", 0).greg == REG_R9);
+  REQUIRE(parse_argument("1@%ah", 0).greg == REG_RAX);
+  REQUIRE(parse_argument("1@%ah", 0).shift == 8);
+
+  const argument memory = parse_argument("-8@8(%rsp)", 0);
+  REQUIRE(memory.kind == argument::memory);
+  REQUIRE(memory.greg == REG_RSP);
+  REQUIRE(memory.displacement == 8);
+  REQUIRE(parse_argument("4@(%rbx)", 0).displacement == 0);
+  REQUIRE(parse_argument("4@-0x10(%ebp)", 0).displacement == -16);
+
+  REQUIRE(kind_of("8@%xmm0") == argument::unknown);
+  REQUIRE(kind_of("8@no_such_symbol(%rip)") == argument::unknown);
+  REQUIRE(kind_of("8@%rax:%rdx") == argument::unknown);
+  REQUIRE(kind_of("nonsense") == argument::unknown);
+}
+
+// A variable for a %rip-relative operand to refer to.
+extern "C" {
+std::uint64_t isocpp_p1950_usdt_variable[2] = {1, 42};
+}
+
+TEST_CASE("%rip-relative arguments are read from their symbol",
+          "[usdt.arguments]") {
+  std::uintptr_t bias = 0;
+  dl_iterate_phdr(&add_load_bias, &bias);
+  const argument a =
+      parse_argument("8@isocpp_p1950_usdt_variable+8(%rip)", bias);
+  REQUIRE(a.kind == argument::absolute);
+  std::uint64_t value = 0;
+  REQUIRE(read_argument(a, mcontext_t{}, value));
+  REQUIRE(value == 42);
+}
+
+#endif
@@ -0,0 +1,251 @@
+#include "inline_indirect_value.h"
+
+#include <array>
+#include <string>
+
+#include "catch2/catch.hpp"
+
+using isocpp_p1950::inline_indirect_value;
+
+namespace {
+
+struct Small {
+  int a{};
+  int b{};
+};
+
+struct Large {
+  std::array<char, 256> data{};
+};
+
+struct ThrowingMove {
+  ThrowingMove() = default;
+  ThrowingMove(const ThrowingMove&) = default;
+  ThrowingMove(ThrowingMove&&) noexcept(false) {}
+};
+
+template <class IV>
+bool stored_in(const IV& iv) {
+  const auto* begin = reinterpret_cast<const unsigned char*>(&iv);
+  const auto* p = reinterpret_cast<const unsigned char*>(iv.operator->());
+  return p >= begin && p < begin + sizeof(IV);
+}
+
+}  // namespace
+
+TEST_CASE("Small objects are stored inline",
+          "[inline_indirect_value.storage]") {
+  REQUIRE(inline_indirect_value<Small>::is_stored_inline());
+  REQUIRE(!inline_indirect_value<Large>::is_stored_inline());
+  REQUIRE(!inline_indirect_value<ThrowingMove>::is_stored_inline());
+  REQUIRE((sizeof(inline_indirect_value<Small>) == 64 || sizeof(void*) != 8));
+
+  GIVEN("An inline_indirect_value of a small type") {
+    inline_indirect_value<Small> iv(std::in_place, Small{1, 2});
+    THEN("The owned object lives inside the inline_indirect_value") {
+      REQUIRE(stored_in(iv));
+      REQUIRE(iv->a == 1);
+      REQUIRE(iv->b == 2);
+    }
+  }
+
+  GIVEN("An inline_indirect_value of a large type") {
+    inline_indirect_value<Large> iv(std::in_place);
+    THEN("The owned object lives on the free store") {
+      REQUIRE(iv);
+      REQUIRE(!stored_in(iv));
+    }
+  }
+}
+
+TEST_CASE("Copy and move of inline_indirect_value",
+          "[inline_indirect_value.copy]") {
+  GIVEN("An engaged inline_indirect_value stored inline") {
+    inline_indirect_value<std::string> a(std::in_place, "hello");
+
+    WHEN("It is copied") {
+      inline_indirect_value<std::string> b(a);
+      THEN("The copy is a deep copy") {
+        REQUIRE(*b == "hello");
+        REQUIRE(&*a != &*b);
+        REQUIRE(stored_in(b));
+      }
+    }
+
+    WHEN("It is moved") {
+      inline_indirect_value<std::string> b(std::move(a));
+      THEN("The source is empty and the target stores the value inline") {
+        REQUIRE(!a);
+        REQUIRE(*b == "hello");
+        REQUIRE(stored_in(b));
+      }
+    }
+
+    WHEN("It is copy assigned and move assigned") {
+      inline_indirect_value<std::string> b(std::in_place, "world");
+      inline_indirect_value<std::string> c;
+      b = a;
+      c = std::move(b);
+      THEN("Values follow the assignments") {
+        REQUIRE(*a == "hello");
+        REQUIRE(!b);
+        REQUIRE(*c == "hello");
+        REQUIRE(stored_in(c));
+      }
+    }
+  }
+
+  GIVEN("An engaged inline_indirect_value stored on the free store") {
+    inline_indirect_value<Large> a(std::in_place);
+    a->data[0] = 'x';
+    const auto* location = a.operator->();
+
+    WHEN("It is moved") {
+      inline_indirect_value<Large> b(std::move(a));
+      THEN("The owned object is not moved") {
+        REQUIRE(!a);
+        REQUIRE(b.operator->() == location);
+      }
+    }
+  }
+}
+
+TEST_CASE("Swap and comparison of inline_indirect_value",
+          "[inline_indirect_value.swap]") {
+  inline_indirect_value<int> a(std::in_place, 1);
+  inline_indirect_value<int> b(std::in_place, 2);
+  inline_indirect_value<int> empty;
+
+  swap(a, b);
+  REQUIRE(*a == 2);
+  REQUIRE(*b == 1);
+  REQUIRE(stored_in(a));
+  REQUIRE(stored_in(b));
+
+  a.swap(empty);
+  REQUIRE(!a);
+  REQUIRE(*empty == 2);
+
+  REQUIRE(a == nullptr);
+  REQUIRE(b != nullptr);
+  REQUIRE(a < b);
+  REQUIRE(b < empty);
+  REQUIRE(b == inline_indirect_value<int>(std::in_place, 1));
+  REQUIRE(std::hash<inline_indirect_value<int>>{}(b) == std::hash<int>{}(1));
+  REQUIRE_THROWS_AS(a.value(), isocpp_p1950::bad_indirect_value_access);
+}
+
+TEST_CASE("inline_indirect_value destroys its owned object",
+          "[inline_indirect_value.dtor]") {
+  struct Counted {
+    int* destructions;
+    ~Counted() { ++*destructions; }
+  };
+  int destructions = 0;
+  {
+    inline_indirect_value<Counted> a(std::in_place, Counted{&destructions});
+    destructions = 0;  // Ignore the temporary.
+    inline_indirect_value<Counted> b(std::move(a));
+    REQUIRE(destructions == 1);  // The moved-from object.
+  }
+  REQUIRE(destructions == 2);
+}
+
+TEST_CASE("Relational operators of inline_indirect_value and its value type",
+          "[inline_indirect_value.relational]") {
+  const inline_indirect_value<int> one(std::in_place, 1);
+  const inline_indirect_value<int> empty;
+
+  GIVEN("An inline_indirect_value and values of its value type") {
+    THEN("It compares as its owned object") {
+      REQUIRE(one == 1);
+      REQUIRE(1 == one);
+      REQUIRE(one != 2);
+      REQUIRE(2 != one);
+      REQUIRE(one < 2);
+      REQUIRE(0 < one);
+      REQUIRE(one > 0);
+      REQUIRE(2 > one);
+      REQUIRE(one <= 1);
+      REQUIRE(1 <= one);
+      REQUIRE(one >= 1);
+      REQUIRE(1 >= one);
+    }
+
+    THEN("An empty one compares less than any value") {
+      REQUIRE(empty != 0);
+      REQUIRE(0 != empty);
+      REQUIRE(!(empty == 0));
+      REQUIRE(empty < 0);
+      REQUIRE(0 > empty);
+      REQUIRE(empty <= 0);
+      REQUIRE(0 >= empty);
+    }
+  }
+
+  GIVEN("An inline_indirect_value and nullptr") {
+    THEN("Only an empty one is ordered equal to nullptr") {
+      REQUIRE(nullptr == empty);
+      REQUIRE(nullptr != one);
+      REQUIRE(!(one < nullptr));
+      REQUIRE(nullptr < one);
+      REQUIRE(one > nullptr);
+      REQUIRE(!(nullptr > one));
+      REQUIRE(empty <= nullptr);
+      REQUIRE(nullptr <= one);
+      REQUIRE(one >= nullptr);
+      REQUIRE(nullptr >= empty);
+    }
+  }
+
+#if defined(__cpp_lib_three_way_comparison) && defined(__cpp_lib_concepts)
+  GIVEN("Three-way comparison") {
+    THEN("It orders as the relational operators do") {
+      REQUIRE(std::is_lt(one <=> 2));
+      REQUIRE(std::is_eq(one <=> 1));
+      REQUIRE(std::is_lt(empty <=> 0));
+      REQUIRE(std::is_gt(one <=> empty));
+      REQUIRE(std::is_eq(empty <=> nullptr));
+      REQUIRE(std::is_gt(one <=> nullptr));
+    }
+  }
+#endif
+}
+
+TEST_CASE("inline_indirect_value compares with indirect_value",
+          "[inline_indirect_value.relational]") {
+  using isocpp_p1950::indirect_value;
+
+  const inline_indirect_value<int> one(std::in_place, 1);
+  const inline_indirect_value<int> empty;
+  const indirect_value<int> heap_one(std::in_place, 1);
+  const indirect_value<long> heap_two(std::in_place, 2);
+  const indirect_value<int> heap_empty;
+
+  THEN("They compare their owned objects") {
+    REQUIRE(one == heap_one);
+    REQUIRE(heap_one == one);
+    REQUIRE(one != heap_two);
+    REQUIRE(one < heap_two);
+    REQUIRE(heap_two > one);
+    REQUIRE(one <= heap_one);
+    REQUIRE(heap_one >= one);
+  }
+
+  THEN("Empty ones compare equal, and less than non-empty ones") {
+    REQUIRE(empty == heap_empty);
+    REQUIRE(heap_empty == empty);
+    REQUIRE(empty < heap_one);
+    REQUIRE(heap_empty < one);
+    REQUIRE(!(one < heap_empty));
+  }
+
+#if defined(__cpp_lib_three_way_comparison) && defined(__cpp_lib_concepts)
+  THEN("Three-way comparison orders them as the relational operators do") {
+    REQUIRE(std::is_eq(one <=> heap_one));
+    REQUIRE(std::is_lt(one <=> heap_two));
+    REQUIRE(std::is_gt(heap_one <=> empty));
+    REQUIRE(std::is_eq(empty <=> heap_empty));
+  }
+#endif
+}
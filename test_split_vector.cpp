@@ -0,0 +1,173 @@
+#include "split_vector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "catch2/catch.hpp"
+
+using isocpp_p1950::split_value;
+using isocpp_p1950::split_vector;
+
+namespace {
+
+// The Element of the hot-cold splitting example of P1950.
+struct SmallData {
+  int key = 0;
+  bool is_active = false;
+  bool active() const { return is_active; }
+  friend bool operator==(const SmallData& a, const SmallData& b) {
+    return a.key == b.key && a.is_active == b.is_active;
+  }
+};
+
+struct LargeData {
+  std::string description;
+  double values[16] = {};
+  friend bool operator==(const LargeData& a, const LargeData& b) {
+    return a.description == b.description;
+  }
+};
+
+using Elements = split_vector<SmallData, LargeData>;
+
+Elements make_elements(int n) {
+  Elements elements;
+  elements.reserve(n);
+  for (int i = 0; i != n; ++i) {
+    elements.emplace_back(SmallData{i, i == n - 1},
+                          LargeData{std::to_string(i)});
+  }
+  return elements;
+}
+
+struct ThrowingCold {
+  ThrowingCold() = default;
+  ThrowingCold(const ThrowingCold&) { throw std::runtime_error("copy"); }
+};
+
+}  // namespace
+
+TEST_CASE("split_vector stores hot and cold parts contiguously",
+          "[split_vector.layout]") {
+  const auto elements = make_elements(100);
+  REQUIRE(elements.size() == 100);
+  REQUIRE(elements.hot().size() == 100);
+  REQUIRE(elements.cold().size() == 100);
+  for (std::size_t i = 0; i != elements.size(); ++i) {
+    REQUIRE(&elements[i].hot() == elements.hot().data() + i);
+    REQUIRE(&*elements[i].cold() == elements.cold().data() + i);
+  }
+}
+
+TEST_CASE("Finding the active element reads only hot parts",
+          "[split_vector.find]") {
+  const auto elements = make_elements(1000);
+  const auto active =
+      std::find_if(elements.begin(), elements.end(),
+                   [](const auto& e) { return e.hot().active(); });
+  REQUIRE(active != elements.end());
+  REQUIRE(active - elements.begin() == 999);
+  REQUIRE(active->cold()->description == "999");
+}
+
+TEST_CASE("Elements have value semantics", "[split_vector.copy]") {
+  GIVEN("A split_vector") {
+    auto elements = make_elements(3);
+
+    WHEN("It is copied") {
+      auto copy = elements;
+
+      THEN("The copy is equal and independent") {
+        REQUIRE(copy == elements);
+        copy[0].cold()->description = "changed";
+        copy[1].hot().key = 42;
+        REQUIRE(elements[0].cold()->description == "0");
+        REQUIRE(elements[1].hot().key == 1);
+        REQUIRE(copy != elements);
+      }
+    }
+
+    WHEN("An element is assigned to another") {
+      elements[0] = elements[2];
+
+      THEN("Both parts are copied") {
+        REQUIRE(elements[0].hot().key == 2);
+        REQUIRE(elements[0].cold()->description == "2");
+        REQUIRE(&*elements[0].cold() != &*elements[2].cold());
+      }
+    }
+
+    WHEN("A cold handle is assigned to another") {
+      elements[0].cold() = elements[1].cold();
+
+      THEN("The cold part is copied") {
+        REQUIRE(elements[0].cold()->description == "1");
+        REQUIRE(elements[0].hot().key == 0);
+      }
+    }
+
+    WHEN("An element is copied out") {
+      split_value<SmallData, LargeData> value = elements[1];
+      value.cold.description = "copy";
+
+      THEN("The element is unchanged") {
+        REQUIRE(elements[1].cold()->description == "1");
+      }
+    }
+  }
+}
+
+TEST_CASE("Constness propagates to the parts of elements",
+          "[split_vector.const]") {
+  using reference = Elements::const_reference;
+  STATIC_REQUIRE(std::is_same_v<decltype(std::declval<reference&>().hot()),
+                                const SmallData&>);
+  STATIC_REQUIRE(
+      std::is_same_v<decltype(*std::declval<reference&>().cold()),
+                     const LargeData&>);
+  STATIC_REQUIRE(std::is_same_v<
+                 decltype(std::declval<const Elements::reference&>().hot()),
+                 const SmallData&>);
+  STATIC_REQUIRE(std::is_same_v<
+                 decltype(std::declval<const Elements::reference&>()
+                              .cold()
+                              .operator->()),
+                 const LargeData*>);
+  STATIC_REQUIRE(std::is_same_v<decltype(*std::declval<const Elements&>()
+                                              .cold()
+                                              .begin()),
+                                const LargeData&>);
+}
+
+TEST_CASE("Modifiers keep the parts in step", "[split_vector.modifiers]") {
+  auto elements = make_elements(5);
+  elements.erase(elements.begin() + 1);
+  REQUIRE(elements.size() == 4);
+  REQUIRE(elements[1].hot().key == 2);
+  REQUIRE(elements[1].cold()->description == "2");
+
+  elements.pop_back();
+  elements.push_back({SmallData{7, false}, LargeData{"7"}});
+  REQUIRE(elements.back().hot().key == 7);
+  REQUIRE(elements.back().cold()->description == "7");
+
+  elements.resize(10);
+  REQUIRE(elements.hot().size() == 10);
+  REQUIRE(elements.cold().size() == 10);
+
+  elements.clear();
+  REQUIRE(elements.empty());
+}
+
+TEST_CASE("A throwing append leaves the split_vector unchanged",
+          "[split_vector.exceptions]") {
+  split_vector<int, ThrowingCold> elements;
+  const ThrowingCold cold;
+  REQUIRE_THROWS_AS(elements.emplace_back(1, cold), std::runtime_error);
+  REQUIRE(elements.empty());
+  REQUIRE(elements.hot().empty());
+}